@@ -0,0 +1,47 @@
+/*! ----------------------------------------------------------------------------
+ * @file	deca_range_tables.h
+ * @brief	DW1000 range correction tables
+ *
+ * @attention
+ *
+ * Copyright 2015 (c) DecaWave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ * @author DecaWave
+ */
+
+#ifndef _DECA_RANGE_TABLES_H_
+#define _DECA_RANGE_TABLES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+
+#define DWT_RANGE_BIAS_STEPS            (256)                   // range steps of 25 cm covered by the correction tables
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: dwt_getrangebias()
+ *
+ * Returns the range bias correction in metres for a range in metres. Scans the correction table on every call,
+ * prefer a table built once with dwt_getrangebiastable()
+ */
+double dwt_getrangebias(uint8 chan, float range, uint8 prf) ;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: dwt_getrangebiastable()
+ *
+ * Fills table with the range bias correction in centimetres for each range step of 25 cm, index 0 covering ranges
+ * below 25 cm and the last index every range from 63.75 m on. Gives the same result as dwt_getrangebias() for
+ * table[(int)(range * 4)].
+ * returns 0 for success, or -1 for an unsupported channel
+ */
+int dwt_getrangebiastable(uint8 chan, uint8 prf, int8 table[DWT_RANGE_BIAS_STEPS]) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_RANGE_TABLES_H_ */
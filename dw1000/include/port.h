@@ -22,6 +22,7 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include "compiler.h"
+#include "deca_device_api.h"
 
 /* DW1000 IRQ handler declaration. */
 // static port_deca_isr_t port_deca_isr;
@@ -134,6 +135,155 @@ typedef enum
 #define S1_SWITCH_OFF (0)
 
 
+/* Places a function on the radio hot path in RAM with CONFIG_TDOA_RAMFUNC */
+#ifdef CONFIG_TDOA_RAMFUNC
+#include <zephyr/linker/section_tags.h>
+#define PORT_RAMFUNC __ramfunc
+#else
+#define PORT_RAMFUNC
+#endif
+
+/* Delays shorter than this spin, longer ones sleep and let other threads run */
+#define PORT_SLEEP_THRESHOLD_US 1000
+
+typedef enum
+{
+    PORT_DELAY_BUSY = 0,
+    PORT_DELAY_SLEEP,
+    PORT_DELAY_MAX
+} port_delay_kind_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t requested_us;
+    uint64_t actual_us;
+    uint32_t max_overshoot_us;
+} port_delay_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_delay_us()
+ *
+ * @brief Wait for at least usec microseconds. Short waits use the calibrated k_busy_wait(), waits of
+ * PORT_SLEEP_THRESHOLD_US and more sleep. Interrupt context always spins
+ *
+ * @param usec delay in microseconds
+ */
+void port_delay_us(uint32_t usec);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_delay_stats()
+ *
+ * @brief Copy the number of delays of one kind with their total requested and measured duration. Delays are only
+ * measured with CONFIG_TDOA_DRIVER_STATS
+ *
+ * @return 0 on success, negative if delays are not measured
+ */
+int port_delay_stats(port_delay_kind_t kind, port_delay_stats_t *stats);
+void port_delay_stats_reset(void);
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t total_ns;
+    uint32_t max_ns;
+} port_lock_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_dw1000_lock()
+ *
+ * @brief Take the DW1000 lock for a sequence of driver calls that must not interleave with other threads. The lock is
+ * recursive and also taken around every SPI transaction, so driver calls may be made while holding it. Only thread
+ * context may access the DW1000
+ */
+void port_dw1000_lock(void);
+void port_dw1000_unlock(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_dw1000_trylock()
+ *
+ * @brief Take the DW1000 lock only if it is free, for background work that must not hold up the radio thread
+ *
+ * @return 0 if the lock was taken, negative if it is held by another thread
+ */
+int port_dw1000_trylock(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_deca_irq_mask()
+ *
+ * @brief Backend of decamutexon(): take the DW1000 lock and defer the DW1000 interrupt, leaving other interrupts
+ * enabled
+ *
+ * @return state to pass to port_deca_irq_restore()
+ */
+decaIrqStatus_t port_deca_irq_mask(void);
+void port_deca_irq_restore(decaIrqStatus_t s);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_lock_stats()
+ *
+ * @brief Copy the number of lock and unlock operations with their total and worst duration. Only measured with
+ * CONFIG_TDOA_DRIVER_STATS
+ *
+ * @return 0 on success, negative if locking is not measured
+ */
+int port_lock_stats(port_lock_stats_t *stats);
+void port_lock_stats_reset(void);
+
+/* Frequency of the timer that timestamps DW1000 interrupts */
+#define PORT_IRQ_CAPTURE_HZ 16000000
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t isr_total_ticks;
+    uint32_t isr_max_ticks;
+    uint64_t thread_total_ticks;
+    uint32_t thread_max_ticks;
+    uint32_t rx_count;
+    uint64_t rx_total_ticks;
+    uint32_t rx_max_ticks;
+} port_irq_capture_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_irq_capture_thread()
+ *
+ * @brief Record the latency from the last DW1000 interrupt edge to the GPIO callback and to the calling thread. Call
+ * when the thread starts handling the interrupt
+ */
+void port_irq_capture_thread(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_irq_capture_edge()
+ *
+ * @brief Hardware timestamp of the last DW1000 interrupt edge
+ *
+ * @param ticks timer ticks at PORT_IRQ_CAPTURE_HZ
+ *
+ * @return 0 on success, negative without CONFIG_TDOA_IRQ_CAPTURE or if the capture could not be set up
+ */
+int port_irq_capture_edge(uint32_t *ticks);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_irq_capture_now()
+ *
+ * @brief Current time of the interrupt capture timer, to relate other events to captured edges
+ *
+ * @return 0 on success, negative if interrupts are not captured
+ */
+int port_irq_capture_now(uint32_t *ticks);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_irq_capture_rx_enabled()
+ *
+ * @brief Record the latency from the last DW1000 interrupt edge to the first RX re-enable after it. Call right after
+ * enabling the receiver
+ */
+void port_irq_capture_rx_enabled(void);
+
+int port_irq_capture_stats(port_irq_capture_stats_t *stats);
+void port_irq_capture_stats_reset(void);
+
 void port_set_dw1000_slowrate(void);
 void port_set_dw1000_fastrate(void);
 
@@ -18,6 +18,7 @@
 #include "deca_param_types.h"
 #include "deca_regs.h"
 #include "deca_device_api.h"
+#include "port.h"
 
 // Defines for enable_clocks function
 #define FORCE_SYS_XTI  0
@@ -918,7 +919,7 @@ void dwt_writetxfctrl(uint16 txFrameLength, uint16 txBufferOffset, int ranging)
  *
  * no return value
  */
-void dwt_readrxdata(uint8 *buffer, uint16 length, uint16 rxBufferOffset)
+PORT_RAMFUNC void dwt_readrxdata(uint8 *buffer, uint16 length, uint16 rxBufferOffset)
 {
     dwt_readfromdevice(RX_BUFFER_ID,rxBufferOffset,length,buffer) ;
 }
@@ -1077,7 +1078,7 @@ uint32 dwt_readtxtimestamplo32(void)
  *
  * no return value
  */
-void dwt_readrxtimestamp(uint8 * timestamp)
+PORT_RAMFUNC void dwt_readrxtimestamp(uint8 * timestamp)
 {
     dwt_readfromdevice(RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, RX_TIME_RX_STAMP_LEN, timestamp) ; // Get the adjusted time of arrival
 }
@@ -1171,7 +1172,7 @@ void dwt_readsystime(uint8 * timestamp)
  *
  * no return value
  */
-void dwt_writetodevice
+PORT_RAMFUNC void dwt_writetodevice
 (
     uint16  recordNumber,
     uint16  index,
@@ -1235,7 +1236,7 @@ void dwt_writetodevice
  *
  * no return value
  */
-void dwt_readfromdevice
+PORT_RAMFUNC void dwt_readfromdevice
 (
     uint16  recordNumber,
     uint16  index,
@@ -1291,7 +1292,7 @@ void dwt_readfromdevice
  *
  * returns 32 bit register value
  */
-uint32 dwt_read32bitoffsetreg(int regFileID, int regOffset)
+PORT_RAMFUNC uint32 dwt_read32bitoffsetreg(int regFileID, int regOffset)
 {
     uint32  regval = 0 ;
     int     j ;
@@ -1320,7 +1321,7 @@ uint32 dwt_read32bitoffsetreg(int regFileID, int regOffset)
  *
  * returns 16 bit register value
  */
-uint16 dwt_read16bitoffsetreg(int regFileID, int regOffset)
+PORT_RAMFUNC uint16 dwt_read16bitoffsetreg(int regFileID, int regOffset)
 {
     uint16  regval = 0 ;
     uint8   buffer[2] ;
@@ -1345,7 +1346,7 @@ uint16 dwt_read16bitoffsetreg(int regFileID, int regOffset)
  *
  * returns 8-bit register value
  */
-uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset)
+PORT_RAMFUNC uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset)
 {
     uint8 regval;
 
@@ -1368,7 +1369,7 @@ uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset)
  *
  * no return value
  */
-void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval)
+PORT_RAMFUNC void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval)
 {
     dwt_writetodevice(regFileID, regOffset, 1, &regval);
 }
@@ -1387,7 +1388,7 @@ void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval)
  *
  * no return value
  */
-void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16 regval)
+PORT_RAMFUNC void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16 regval)
 {
     uint8   buffer[2] ;
 
@@ -1411,7 +1412,7 @@ void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16 regval)
  *
  * no return value
  */
-void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32 regval)
+PORT_RAMFUNC void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32 regval)
 {
     int     j ;
     uint8   buffer[4] ;
@@ -2357,7 +2358,7 @@ void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_c
  *
  * return value is 1 if the IRQS bit is set and 0 otherwise
  */
-uint8 dwt_checkirq(void)
+PORT_RAMFUNC uint8 dwt_checkirq(void)
 {
     return (dwt_read8bitoffsetreg(SYS_STATUS_ID, SYS_STATUS_OFFSET) & SYS_STATUS_IRQS); // Reading the lower byte only is enough for this operation
 }
@@ -2386,7 +2387,7 @@ uint8 dwt_checkirq(void)
  *
  * no return value
  */
-void dwt_isr(void)
+PORT_RAMFUNC void dwt_isr(void)
 {
     uint32 status = pdw1000local->cbData.status = dwt_read32bitreg(SYS_STATUS_ID); // Read status register low 32bits
 
@@ -2819,7 +2820,7 @@ int dwt_starttx(uint8 mode)
  *
  * no return value
  */
-void dwt_forcetrxoff(void)
+PORT_RAMFUNC void dwt_forcetrxoff(void)
 {
     decaIrqStatus_t stat ;
     uint32 mask;
@@ -2999,7 +3000,7 @@ void dwt_setsnoozetime(uint8 snooze_time)
  *
  * returns DWT_SUCCESS for success, or DWT_ERROR for error (e.g. a delayed receive enable will be too far in the future if delayed time has passed)
  */
-int dwt_rxenable(int mode)
+PORT_RAMFUNC int dwt_rxenable(int mode)
 {
     uint16 temp ;
     uint8 temp1 ;
@@ -50,8 +50,8 @@
  */
 decaIrqStatus_t decamutexon(void)           
 {
-	//TODO
-	return 0 ;   // return state before disable, value is used to re-enable in decamutexoff call
+	// masks only the DW1000 interrupt and serializes threads, see port.c
+	return port_deca_irq_mask();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -71,5 +71,5 @@ decaIrqStatus_t decamutexon(void)
  */
 void decamutexoff(decaIrqStatus_t s)        // put a function here that re-enables the interrupt at the end of the critical section
 {
-	//TODO
+	port_deca_irq_restore(s);
 }
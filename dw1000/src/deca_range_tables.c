@@ -14,6 +14,7 @@
 
 #include "deca_device_api.h"
 #include "deca_param_types.h"
+#include "deca_range_tables.h"
 
 #define NUM_16M_OFFSET  (37)
 #define NUM_16M_OFFSETWB  (68)
@@ -696,3 +697,66 @@ double dwt_getrangebias(uint8 chan, float range, uint8 prf)
 
     return (mOffset) ;
 }
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: dwt_getrangebiastable()
+ *
+ * Description: This function expands the range bias correction table of a channel and PRF into a table indexed
+ * directly by range in units of 25 cm, so that the correction of a range is a single lookup.
+ *
+ * input parameters:
+ * @param chan  - specifies the operating channel (e.g. 1, 2, 3, 4, 5 or 7)
+ * @param prf	- this is the PRF e.g. DWT_PRF_16M or DWT_PRF_64M
+ *
+ * output parameters
+ * @param table - correction in centimetres for each range step of 25 cm
+ *
+ * returns 0 for success, or -1 for an unsupported channel
+ */
+int dwt_getrangebiastable(uint8 chan, uint8 prf, int8 table[DWT_RANGE_BIAS_STEPS])
+{
+    const uint8 *ranges ;
+    int cmoffset ;
+
+    if ((chan >= NUM_CH_SUPPORTED) || (chan == 0) || (chan == 6))
+    {
+        return -1 ;
+    }
+
+    if (prf == DWT_PRF_16M)
+    {
+        if ((chan == 4) || (chan == 7))
+        {
+            ranges = range25cm16PRFwb[chan_idxwb[chan]] ;
+            cmoffset = CM_OFFSET_16M_WB ;
+        }
+        else
+        {
+            ranges = range25cm16PRFnb[chan_idxnb[chan]] ;
+            cmoffset = CM_OFFSET_16M_NB ;
+        }
+    }
+    else // 64M PRF
+    {
+        if ((chan == 4) || (chan == 7))
+        {
+            ranges = range25cm64PRFwb[chan_idxwb[chan]] ;
+            cmoffset = CM_OFFSET_64M_WB ;
+        }
+        else
+        {
+            ranges = range25cm64PRFnb[chan_idxnb[chan]] ;
+            cmoffset = CM_OFFSET_64M_NB ;
+        }
+    }
+
+    // the ranges only grow, so a single pass over both tables finds the index of every step (all tables end in 255 !!!!)
+    int i = 0 ;
+    for (int rangeint25cm = 0 ; rangeint25cm < DWT_RANGE_BIAS_STEPS ; rangeint25cm++)
+    {
+        while (rangeint25cm > ranges[i]) i++ ;
+        table[rangeint25cm] = (int8) (i + cmoffset) ;
+    }
+
+    return 0 ;
+}
@@ -20,6 +20,6 @@
 /* Wrapper function to be used by decadriver. Declared in deca_device_api.h */
 void deca_sleep(unsigned int time_ms)
 {
-	k_msleep(time_ms);
+	port_delay_us(time_ms * 1000);
 }
 
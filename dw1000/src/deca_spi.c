@@ -135,7 +135,7 @@ int closespi(void)
  * Takes two separate byte buffers for write header and write data
  * returns 0 for success
  */
-int writetospi(uint16 headerLength,
+PORT_RAMFUNC int writetospi(uint16 headerLength,
                const uint8 *headerBuffer,
                uint32 bodyLength,
                const uint8 *bodyBuffer)
@@ -170,7 +170,7 @@ int writetospi(uint16 headerLength,
  * returns the offset into read buffer where first byte of read data
  * may be found, or returns 0
  */
-int readfromspi(uint16 headerLength,
+PORT_RAMFUNC int readfromspi(uint16 headerLength,
                 const uint8 *headerBuffer,
                 uint32 readLength,
                 uint8 *readBuffer)
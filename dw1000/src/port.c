@@ -20,11 +20,17 @@
 // zephyr includes
 #include <errno.h>
 #include <zephyr/kernel.h>
-#include <zephyr/sys/printk.h>
+#include <zephyr/logging/log.h>
 #include <zephyr/device.h>
 #include <soc.h>
 #include <hal/nrf_gpiote.h>
 #include <zephyr/drivers/gpio.h>
+#include <zephyr/timing/timing.h>
+#ifdef CONFIG_TDOA_IRQ_CAPTURE
+#include <nrfx_ppi.h>
+#endif
+
+LOG_MODULE_REGISTER(port);
 
 static const struct device * gpio_dev;
 static struct gpio_callback gpio_cb;
@@ -48,29 +54,254 @@ static volatile uint32_t signalResetDone;
  *
  *******************************************************************************/
 
+#if defined(CONFIG_TDOA_DRIVER_STATS) || defined(CONFIG_TDOA_IRQ_CAPTURE)
+static struct k_spinlock stats_lock;
+#endif
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+static port_delay_stats_t delay_stats[PORT_DELAY_MAX];
+static bool timing_ready;
+
+static timing_t stats_timing_start(void)
+{
+    if (!timing_ready)
+    {
+        timing_init();
+        timing_start();
+        timing_ready = true;
+    }
+
+    return timing_counter_get();
+}
+
+static void delay_stats_record(port_delay_kind_t kind, uint32_t usec, uint64_t actual_us)
+{
+    const uint32_t overshoot_us = actual_us > usec ? actual_us - usec : 0;
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    port_delay_stats_t *stats = &delay_stats[kind];
+    ++stats->count;
+    stats->requested_us += usec;
+    stats->actual_us += actual_us;
+    if (overshoot_us > stats->max_overshoot_us)
+    {
+        stats->max_overshoot_us = overshoot_us;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+#endif
+
+/* @fn    port_delay_us
+ * @brief calibrated delay: spins with k_busy_wait() below
+ *        PORT_SLEEP_THRESHOLD_US and yields to other threads above
+ * */
+void port_delay_us(uint32_t usec)
+{
+    const port_delay_kind_t kind = usec < PORT_SLEEP_THRESHOLD_US ? PORT_DELAY_BUSY : PORT_DELAY_SLEEP;
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t start = stats_timing_start();
+#endif
+
+    if (kind == PORT_DELAY_BUSY || k_is_in_isr())
+    {
+        k_busy_wait(usec);
+    }
+    else
+    {
+        k_usleep(usec);
+    }
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t end = timing_counter_get();
+    delay_stats_record(kind, usec, timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000);
+#endif
+}
+
+/* @fn    port_delay_stats
+ * @brief copy the requested and measured durations of one kind of delay
+ * */
+int port_delay_stats(port_delay_kind_t kind, port_delay_stats_t *stats)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    if (kind >= PORT_DELAY_MAX)
+    {
+        return -1;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = delay_stats[kind];
+    k_spin_unlock(&stats_lock, key);
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void port_delay_stats_reset(void)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    memset(delay_stats, 0, sizeof(delay_stats));
+    k_spin_unlock(&stats_lock, key);
+#endif
+}
+
 /* @fn    usleep
- * @brief precise usleep() delay
+ * @brief microsecond delay for code written against the Decawave examples
  * */
-#pragma GCC optimize ("O0")
 int usleep(unsigned long usec)
 {
-    int i,j;
-#pragma GCC ivdep
-    for(i=0;i<usec;i++)
+    port_delay_us(usec);
+    return 0;
+}
+
+/****************************************************************************//**
+ *
+ *                              END OF Time section
+ *
+ *******************************************************************************/
+
+/****************************************************************************//**
+ *
+ *                              Locking section
+ *
+ *******************************************************************************/
+
+/* Serializes threads using the DW1000, recursive so API calls nest */
+K_MUTEX_DEFINE(dw1000_mutex);
+
+/* The GPIO callback defers the DW1000 interrupt while a critical section is open */
+static atomic_t deca_irq_masked;
+static atomic_t deca_irq_pending;
+static port_deca_isr_t port_deca_isr;
+
+#ifdef CONFIG_TDOA_IRQ_CAPTURE
+static int irq_capture_init(void);
+static void irq_capture_isr(void);
+#endif
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+static port_lock_stats_t lock_stats;
+
+static void lock_stats_record(timing_t *start, timing_t *end)
+{
+    const uint32_t ns = timing_cycles_to_ns(timing_cycles_get(start, end));
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    ++lock_stats.count;
+    lock_stats.total_ns += ns;
+    if (ns > lock_stats.max_ns)
     {
-#pragma GCC ivdep
-        for(j=0;j<2;j++)
+        lock_stats.max_ns = ns;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+#endif
+
+void port_dw1000_lock(void)
+{
+    k_mutex_lock(&dw1000_mutex, K_FOREVER);
+}
+
+void port_dw1000_unlock(void)
+{
+    k_mutex_unlock(&dw1000_mutex);
+}
+
+int port_dw1000_trylock(void)
+{
+    return k_mutex_lock(&dw1000_mutex, K_NO_WAIT) == 0 ? 0 : -1;
+}
+
+/* @fn    port_deca_irq_mask
+ * @brief take the device lock and defer the DW1000 interrupt
+ * @return 1 if the interrupt was already deferred by an enclosing section
+ * */
+PORT_RAMFUNC decaIrqStatus_t port_deca_irq_mask(void)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t start = stats_timing_start();
+#endif
+
+    k_mutex_lock(&dw1000_mutex, K_FOREVER);
+    const decaIrqStatus_t s = atomic_set(&deca_irq_masked, 1);
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t end = timing_counter_get();
+    lock_stats_record(&start, &end);
+#endif
+
+    return s;
+}
+
+/* @fn    port_deca_irq_restore
+ * @brief restore the state returned by port_deca_irq_mask(), delivering an
+ *        interrupt that arrived meanwhile, and release the device lock
+ * */
+PORT_RAMFUNC void port_deca_irq_restore(decaIrqStatus_t s)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t start = timing_counter_get();
+#endif
+
+    if (!s)
+    {
+        atomic_clear(&deca_irq_masked);
+        if (atomic_clear(&deca_irq_pending) && port_deca_isr != NULL)
         {
-            // __NOP();
-            // __NOP();
+            port_deca_isr();
         }
     }
+    k_mutex_unlock(&dw1000_mutex);
+
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    timing_t end = timing_counter_get();
+    lock_stats_record(&start, &end);
+#endif
+}
+
+int port_lock_stats(port_lock_stats_t *stats)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = lock_stats;
+    k_spin_unlock(&stats_lock, key);
+
     return 0;
+#else
+    return -1;
+#endif
+}
+
+void port_lock_stats_reset(void)
+{
+#ifdef CONFIG_TDOA_DRIVER_STATS
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    memset(&lock_stats, 0, sizeof(lock_stats));
+    k_spin_unlock(&stats_lock, key);
+#endif
+}
+
+static PORT_RAMFUNC void deca_gpio_callback(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+#ifdef CONFIG_TDOA_IRQ_CAPTURE
+    irq_capture_isr();
+#endif
+
+    if (atomic_get(&deca_irq_masked))
+    {
+        atomic_set(&deca_irq_pending, 1);
+        return;
+    }
+
+    port_deca_isr();
 }
 
 /****************************************************************************//**
  *
- *                              END OF Time section
+ *                              END OF Locking section
  *
  *******************************************************************************/
 
@@ -146,20 +377,252 @@ void port_set_deca_isr(port_deca_isr_t deca_isr)
     // gpio_dev = device_get_binding(DT_LABEL(DT_NODELABEL(gpio0))); // changed 10/23/23
     gpio_dev = DEVICE_DT_GET(DT_NODELABEL(gpio0));
     if (!gpio_dev) {
-        printk("error\n");
+        LOG_ERR("GPIO device for the DW1000 IRQ not found");
         return;
     }
 
     /* Decawave interrupt */
     gpio_pin_configure(gpio_dev, GPIO_PIN, (GPIO_INPUT | GPIO_FLAGS));
 
-    gpio_init_callback(&gpio_cb, (gpio_callback_handler_t)(deca_isr), BIT(GPIO_PIN));
+    port_deca_isr = deca_isr;
+    gpio_init_callback(&gpio_cb, deca_gpio_callback, BIT(GPIO_PIN));
 
     gpio_add_callback(gpio_dev, &gpio_cb);
 
     gpio_pin_interrupt_configure(gpio_dev, GPIO_PIN, GPIO_INT_EDGE_RISING);
+
+#ifdef CONFIG_TDOA_IRQ_CAPTURE
+    if (irq_capture_init() != 0)
+    {
+        LOG_WRN("DW1000 IRQ capture unavailable");
+    }
+#endif
 }
 
+/****************************************************************************//**
+ *
+ *                              IRQ capture section
+ *
+ *******************************************************************************/
+
+#ifdef CONFIG_TDOA_IRQ_CAPTURE
+
+/*
+ * The GPIOTE IN event of the DW1000 IRQ pin triggers CAPTURE[0] of a free
+ * running timer over PPI, so CC[0] holds the time of the last edge with no
+ * software in the path. CC[1] is captured when the GPIO callback runs, CC[2]
+ * when the radio thread handles the interrupt and CC[3] on request.
+ */
+#define CAPTURE_TIMER NRF_TIMER2
+#define CC_EDGE 0
+#define CC_ISR 1
+#define CC_THREAD 2
+#define CC_NOW 3
+
+static bool irq_capture_ready;
+static bool rx_enable_pending;
+// Set by the GPIO callback, the radio thread is also woken by other threads
+static atomic_t edge_captured;
+static volatile uint32_t isr_ticks;
+static port_irq_capture_stats_t irq_capture_stats;
+
+static int irq_capture_init(void)
+{
+    // the GPIO driver allocated a GPIOTE channel in event mode for the pin
+    int gpiote_channel = -1;
+    for (int i = 0; i < GPIOTE_CH_NUM; ++i)
+    {
+        const uint32_t config = NRF_GPIOTE->CONFIG[i];
+        if ((config & GPIOTE_CONFIG_MODE_Msk) == (GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) &&
+            ((config & GPIOTE_CONFIG_PSEL_Msk) >> GPIOTE_CONFIG_PSEL_Pos) == GPIO_PIN)
+        {
+            gpiote_channel = i;
+            break;
+        }
+    }
+    if (gpiote_channel < 0)
+    {
+        return -1;
+    }
+
+    nrf_ppi_channel_t ppi_channel;
+    if (nrfx_ppi_channel_alloc(&ppi_channel) != NRFX_SUCCESS)
+    {
+        return -2;
+    }
+
+    CAPTURE_TIMER->TASKS_STOP = 1;
+    CAPTURE_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    CAPTURE_TIMER->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    CAPTURE_TIMER->PRESCALER = 0;
+    CAPTURE_TIMER->TASKS_CLEAR = 1;
+    CAPTURE_TIMER->TASKS_START = 1;
+
+    NRF_PPI->CH[ppi_channel].EEP = (uint32_t)&NRF_GPIOTE->EVENTS_IN[gpiote_channel];
+    NRF_PPI->CH[ppi_channel].TEP = (uint32_t)&CAPTURE_TIMER->TASKS_CAPTURE[CC_EDGE];
+    NRF_PPI->CHENSET = BIT(ppi_channel);
+
+    irq_capture_ready = true;
+
+    return 0;
+}
+
+static PORT_RAMFUNC void irq_capture_isr(void)
+{
+    if (irq_capture_ready)
+    {
+        CAPTURE_TIMER->TASKS_CAPTURE[CC_ISR] = 1;
+        isr_ticks = CAPTURE_TIMER->CC[CC_ISR];
+        atomic_set(&edge_captured, 1);
+    }
+}
+
+PORT_RAMFUNC void port_irq_capture_thread(void)
+{
+    if (!irq_capture_ready)
+    {
+        return;
+    }
+
+    // a wake-up without a new edge would be measured against a stale one
+    if (atomic_clear(&edge_captured))
+    {
+        CAPTURE_TIMER->TASKS_CAPTURE[CC_THREAD] = 1;
+        const uint32_t edge = CAPTURE_TIMER->CC[CC_EDGE];
+        const uint32_t isr_latency = isr_ticks - edge;
+        const uint32_t thread_latency = CAPTURE_TIMER->CC[CC_THREAD] - edge;
+
+        k_spinlock_key_t key = k_spin_lock(&stats_lock);
+        port_irq_capture_stats_t *stats = &irq_capture_stats;
+        ++stats->count;
+        stats->isr_total_ticks += isr_latency;
+        stats->thread_total_ticks += thread_latency;
+        if (isr_latency > stats->isr_max_ticks)
+        {
+            stats->isr_max_ticks = isr_latency;
+        }
+        if (thread_latency > stats->thread_max_ticks)
+        {
+            stats->thread_max_ticks = thread_latency;
+        }
+        k_spin_unlock(&stats_lock, key);
+
+        rx_enable_pending = true;
+    }
+    else
+    {
+        // RX re-enables after config commits or queued frames say nothing about interrupt latency
+        rx_enable_pending = false;
+    }
+}
+
+PORT_RAMFUNC void port_irq_capture_rx_enabled(void)
+{
+    if (!irq_capture_ready || !rx_enable_pending)
+    {
+        return;
+    }
+    rx_enable_pending = false;
+
+    CAPTURE_TIMER->TASKS_CAPTURE[CC_THREAD] = 1;
+    const uint32_t rx_latency = CAPTURE_TIMER->CC[CC_THREAD] - CAPTURE_TIMER->CC[CC_EDGE];
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    port_irq_capture_stats_t *stats = &irq_capture_stats;
+    ++stats->rx_count;
+    stats->rx_total_ticks += rx_latency;
+    if (rx_latency > stats->rx_max_ticks)
+    {
+        stats->rx_max_ticks = rx_latency;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+int port_irq_capture_edge(uint32_t *ticks)
+{
+    if (!irq_capture_ready)
+    {
+        return -1;
+    }
+
+    *ticks = CAPTURE_TIMER->CC[CC_EDGE];
+
+    return 0;
+}
+
+int port_irq_capture_now(uint32_t *ticks)
+{
+    if (!irq_capture_ready)
+    {
+        return -1;
+    }
+
+    const unsigned int key = irq_lock();
+    CAPTURE_TIMER->TASKS_CAPTURE[CC_NOW] = 1;
+    *ticks = CAPTURE_TIMER->CC[CC_NOW];
+    irq_unlock(key);
+
+    return 0;
+}
+
+int port_irq_capture_stats(port_irq_capture_stats_t *stats)
+{
+    if (!irq_capture_ready)
+    {
+        return -1;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = irq_capture_stats;
+    k_spin_unlock(&stats_lock, key);
+
+    return 0;
+}
+
+void port_irq_capture_stats_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    memset(&irq_capture_stats, 0, sizeof(irq_capture_stats));
+    k_spin_unlock(&stats_lock, key);
+}
+
+#else
+
+void port_irq_capture_thread(void)
+{
+}
+
+void port_irq_capture_rx_enabled(void)
+{
+}
+
+int port_irq_capture_edge(uint32_t *ticks)
+{
+    return -1;
+}
+
+int port_irq_capture_now(uint32_t *ticks)
+{
+    return -1;
+}
+
+int port_irq_capture_stats(port_irq_capture_stats_t *stats)
+{
+    return -1;
+}
+
+void port_irq_capture_stats_reset(void)
+{
+}
+
+#endif // CONFIG_TDOA_IRQ_CAPTURE
+
+/****************************************************************************//**
+ *
+ *                              END OF IRQ capture section
+ *
+ *******************************************************************************/
+
 /****************************************************************************//**
  *
  *******************************************************************************/
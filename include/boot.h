@@ -1,5 +1,5 @@
 /**
- * @file uwb_utils.c
+ * @file boot.h
  * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
  * @brief
  * @version 1.0.0
@@ -29,16 +29,36 @@
  *
  */
 
-#include "uwb_utils.h"
+#ifndef __BOOT_H__
+#define __BOOT_H__
 
-uint64_t uwb_utils_timestamp_to_u64(uint8_t *timestamp_buffer)
+#include <stdint.h>
+
+typedef enum
 {
-    uint64_t ts = 0;
-    int i;
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= timestamp_buffer[i];
-    }
-    return ts;
-}
+    BOOT_PHASE_MAIN = 0,
+    BOOT_PHASE_FLASH_MOUNTED,
+    BOOT_PHASE_CONFIG_VALID,
+    BOOT_PHASE_RADIO_INITIALIZED,
+    BOOT_PHASE_RADIO_STARTED,
+    BOOT_PHASE_FIRST_FRAME,
+    BOOT_PHASE_MAX
+} boot_phase_t;
+
+/**
+ * @brief Record the time since power-on at which a boot phase was reached.
+ * Only the first call per phase is kept
+ * @param phase: boot phase
+ */
+void boot_mark(boot_phase_t phase);
+
+/**
+ * @brief Time since power-on at which a boot phase was reached
+ * @param phase: boot phase
+ * @return microseconds since power-on, negative if the phase was not reached
+ */
+int64_t boot_phase_us(boot_phase_t phase);
+
+const char *boot_phase_name(boot_phase_t phase);
+
+#endif // __BOOT_H__
@@ -32,53 +32,306 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-#define CONFIG_SIZE_BUFFER 128
+#define CONFIG_SIZE_BUFFER 1024
+
+// Field ids are stored in one byte
+#define CONFIG_FIELD_ID_MAX 256
 
 typedef enum
 {
-    CONFIG_FIELD_MODE = 0,
-    CONFIG_FIELD_ADDRESS,
-    CONFIG_FIELD_ANCHOR_X_POS_MM,
-    CONFIG_FIELD_ANCHOR_Y_POS_MM,
+    CONFIG_TYPE_U8 = 0,
+    CONFIG_TYPE_U16,
+    CONFIG_TYPE_U32,
+    CONFIG_TYPE_MAX
+} config_type_t;
+
+/**
+ * Configuration schema: X(field, name, type, count, default, min, max)
+ *
+ * The position in this table is the TLV id stored in flash, so new fields
+ * must be appended. The default, min and max apply to every element
+ */
+#define CONFIG_SCHEMA(X)                                                                                     \
+    X(MODE, "mode", CONFIG_TYPE_U8, 1, CONFIG_MODE_DEFAULT, 0, CONFIG_MODE_DEFAULT)                          \
+    X(ADDRESS, "address", CONFIG_TYPE_U8, 8, 0, 0, 0xFF)                                                     \
+    X(ANCHOR_X_POS_MM, "anchor_x_pos_mm", CONFIG_TYPE_U32, 1, 0, 0, UINT32_MAX)                              \
+    X(ANCHOR_Y_POS_MM, "anchor_y_pos_mm", CONFIG_TYPE_U32, 1, 0, 0, UINT32_MAX)                              \
+    X(ANCHOR_Z_POS_MM, "anchor_z_pos_mm", CONFIG_TYPE_U32, 1, 0, 0, UINT32_MAX)                              \
+    X(TX_ANTENNA_DELAY, "tx_antenna_delay", CONFIG_TYPE_U16, 1, 16436, 0, UINT16_MAX)                        \
+    X(RX_ANTENNA_DELAY, "rx_antenna_delay", CONFIG_TYPE_U16, 1, 16436, 0, UINT16_MAX)                        \
+    X(PHY_PROFILE, "phy_profile", CONFIG_TYPE_U8, 1, CONFIG_PHY_PROFILE_DEFAULT, 0, CONFIG_PHY_PROFILE_LAST) \
+    X(SYNC_INTERVAL_MS, "sync_interval_ms", CONFIG_TYPE_U16, 1, 200, 10, 10000)                              \
+    X(ANCHOR_COUNT, "anchor_count", CONFIG_TYPE_U8, 1, 4, 1, 64)                                             \
+    X(XTAL_TRIM, "xtal_trim", CONFIG_TYPE_U8, 1, CONFIG_XTAL_TRIM_FACTORY, 0, CONFIG_XTAL_TRIM_FACTORY)
+
+// Dummy mode, the highest valid uwb_mode_t
+#define CONFIG_MODE_DEFAULT 2
+// Default and highest valid uwb_phy_profile_t
+#define CONFIG_PHY_PROFILE_DEFAULT 1
+#define CONFIG_PHY_PROFILE_LAST 2
+// Crystal trim steps are 0 to 31, this value keeps the factory trim
+#define CONFIG_XTAL_TRIM_FACTORY 32
+
+#define CONFIG_FIELD_ENUM(field, name, type, count, default_value, min, max) CONFIG_FIELD_##field,
+
+typedef enum
+{
+    CONFIG_SCHEMA(CONFIG_FIELD_ENUM)
     CONFIG_FIELD_MAX
 } config_field_t;
 
+#define CONFIG_FIELD_WORDS ((CONFIG_FIELD_MAX + 31) / 32)
+
+// Set of fields, one bit per field, as tracked by observers, validators and
+// transactions
+typedef struct
+{
+    uint32_t words[CONFIG_FIELD_WORDS];
+} config_fields_t;
+
+/**
+ * @brief Build a field set from a list of fields, e.g.
+ * CONFIG_FIELDS(CONFIG_FIELD_MODE, CONFIG_FIELD_ADDRESS)
+ */
+#define CONFIG_FIELDS(...)                                                                                   \
+    config_fields_of((const config_field_t[]){__VA_ARGS__},                                                  \
+                     sizeof((const config_field_t[]){__VA_ARGS__}) / sizeof(config_field_t))
+
+static inline void config_fields_add(config_fields_t *fields, config_field_t field)
+{
+    fields->words[field / 32] |= 1UL << (field % 32);
+}
+
+static inline void config_fields_remove(config_fields_t *fields, config_field_t field)
+{
+    fields->words[field / 32] &= ~(1UL << (field % 32));
+}
+
+static inline bool config_fields_has(const config_fields_t *fields, config_field_t field)
+{
+    return (fields->words[field / 32] & (1UL << (field % 32))) != 0;
+}
+
+static inline config_fields_t config_fields_of(const config_field_t *list, size_t count)
+{
+    config_fields_t fields = {0};
+    for (size_t i = 0; i < count; ++i)
+    {
+        config_fields_add(&fields, list[i]);
+    }
+    return fields;
+}
+
+static inline config_fields_t config_fields_all()
+{
+    config_fields_t fields = {0};
+    for (int i = 0; i < CONFIG_FIELD_MAX; ++i)
+    {
+        config_fields_add(&fields, (config_field_t)i);
+    }
+    return fields;
+}
+
+/**
+ * @brief Add every field of src to dst
+ */
+static inline void config_fields_merge(config_fields_t *dst, const config_fields_t *src)
+{
+    for (int i = 0; i < CONFIG_FIELD_WORDS; ++i)
+    {
+        dst->words[i] |= src->words[i];
+    }
+}
+
+/**
+ * @brief Fields present in both sets
+ * @return true if the intersection is not empty
+ */
+static inline bool config_fields_intersect(const config_fields_t *a, const config_fields_t *b,
+                                           config_fields_t *common)
+{
+    uint32_t any = 0;
+    for (int i = 0; i < CONFIG_FIELD_WORDS; ++i)
+    {
+        common->words[i] = a->words[i] & b->words[i];
+        any |= common->words[i];
+    }
+    return any != 0;
+}
+
+static inline int config_fields_count(const config_fields_t *fields)
+{
+    int count = 0;
+    for (int i = 0; i < CONFIG_FIELD_WORDS; ++i)
+    {
+        count += __builtin_popcount(fields->words[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Called after a commit that changed at least one observed field
+ * @param fields: the changed fields among the observed ones
+ */
+typedef void (*config_observer_t)(const config_fields_t *fields);
+
+/**
+ * @brief Called before a commit that changes at least one validated field,
+ * with the new values readable through config_get()
+ * @param fields: the changed fields among the validated ones
+ * @return 0 to accept the changes, negative to reject the whole commit
+ */
+typedef int (*config_validator_t)(const config_fields_t *fields);
+
+typedef struct
+{
+    const char *name;
+    config_type_t type;
+    uint8_t count;
+    uint32_t default_value;
+    uint32_t min;
+    uint32_t max;
+} config_schema_t;
+
+_Static_assert(CONFIG_FIELD_MAX <= CONFIG_FIELD_ID_MAX, "Too many config fields");
+
 int config_init();
+
+/**
+ * @brief Start a configuration transaction. Writes until the matching
+ * config_commit() only update the RAM copy. Transactions nest and hold the
+ * configuration lock, so other threads block until commit or abort
+ * @return 0
+ */
+int config_begin();
+
+/**
+ * @brief Commit the outermost transaction atomically. A single changed field
+ * is written to its own entry. Several are first written as one commit record
+ * before their entries, and a commit interrupted by a power loss is completed
+ * at boot. If the entry or the record cannot be written the RAM copy is
+ * rolled back to the last committed state and no observer is notified
+ * @return 0 on success, -4 if a validator rejected the changes, other
+ * negative values on error
+ */
+int config_commit();
+
+/**
+ * @brief Discard all uncommitted writes and end the transaction. Aborting a
+ * nested transaction makes the outermost commit fail
+ */
+void config_abort();
+
+/**
+ * @brief Register a callback for changes of the given fields. Callbacks run
+ * in the committing thread after the configuration lock is released, so they
+ * may read the configuration but should defer slow work. Register during
+ * initialization
+ * @param fields: fields to observe, see CONFIG_FIELDS()
+ * @return 0 on success, negative if no observer slot is free
+ */
+int config_observe(config_fields_t fields, config_observer_t callback);
+
+/**
+ * @brief Register a check of values that depend on each other, which the
+ * schema ranges cannot express. Validators run in the committing thread with
+ * the configuration lock held and must not start a transaction. Register
+ * during initialization
+ * @param fields: fields to validate, see CONFIG_FIELDS()
+ * @return 0 on success, negative if no validator slot is free
+ */
+int config_validate(config_fields_t fields, config_validator_t validator);
+
 int config_erase();
 int config_refresh();
-void config_buffer(uint8_t *buffer, size_t size);
+/**
+ * @brief Copy part of the used configuration image (header, TLV data and CRC)
+ * @param buffer: destination
+ * @param offset: offset into the image
+ * @param size: maximum number of bytes to copy
+ * @return number of bytes copied, 0 past the end of the image
+ */
+size_t config_buffer(uint8_t *buffer, size_t offset, size_t size);
 
 int config_field_size(config_field_t field, uint8_t *size);
 
-int config_read_u8(config_field_t field, uint8_t *value);
-int config_read_u16(config_field_t field, uint16_t *value);
-int config_read_u32(config_field_t field, uint32_t *value);
-int config_read_u64(config_field_t field, uint64_t *value);
-int config_read_float(config_field_t field, float *value);
-int config_read_double(config_field_t field, double *value);
-
-int config_write_u8(config_field_t field, uint8_t value);
-int config_write_u16(config_field_t field, uint16_t value);
-int config_write_u32(config_field_t field, uint32_t value);
-int config_write_u64(config_field_t field, uint64_t value);
-int config_write_float(config_field_t field, float value);
-int config_write_double(config_field_t field, double value);
-
-int config_read_u8_array(config_field_t field, uint8_t length, uint8_t *array);
-int config_read_u16_array(config_field_t field, uint8_t length, uint16_t *array);
-int config_read_u32_array(config_field_t field, uint8_t length, uint32_t *array);
-int config_read_u64_array(config_field_t field, uint8_t length, uint64_t *array);
-int config_read_float_array(config_field_t field, uint8_t length, float *array);
-int config_read_double_array(config_field_t field, uint8_t length, double *array);
-
-int config_write_u8_array(config_field_t field, uint8_t length, uint8_t *array);
-int config_write_u16_array(config_field_t field, uint8_t length, uint16_t *array);
-int config_write_u32_array(config_field_t field, uint8_t length, uint32_t *array);
-int config_write_u64_array(config_field_t field, uint8_t length, uint64_t *array);
-int config_write_float_array(config_field_t field, uint8_t length, float *array);
-int config_write_double_array(config_field_t field, uint8_t length, double *array);
+/**
+ * @brief Get the schema entry of a field
+ * @return NULL if the field is unknown
+ */
+const config_schema_t *config_schema(config_field_t field);
+
+/**
+ * @brief Look up a field by its schema name
+ * @return field on success, negative if no field has that name
+ */
+int config_field_by_name(const char *name);
+
+/**
+ * @brief Size of a single element of the given type in bytes
+ */
+size_t config_type_size(config_type_t type);
+
+/**
+ * @brief Size of a field's value as described by the schema
+ */
+size_t config_schema_size(config_field_t field);
+
+/**
+ * @brief Read a field. The size must match the schema
+ * @return 0 on success, negative on error or if the field is not stored
+ */
+int config_get(config_field_t field, void *value, size_t size);
+
+/**
+ * @brief Validate a value against the schema and write it. Outside of a
+ * transaction the change is committed to flash immediately
+ * @return 0 on success, negative on size, range or flash errors
+ */
+int config_set(config_field_t field, const void *value, size_t size);
+
+/**
+ * @brief Fill a value with the schema default of a field
+ * @return 0 on success, negative if the size does not match the schema
+ */
+int config_default(config_field_t field, void *value, size_t size);
+
+/**
+ * @brief Read one element of a field widened to 32 bits
+ */
+int config_get_element(config_field_t field, uint8_t index, uint32_t *value);
+
+/**
+ * @brief Validate a batch of TLV records against the schema and apply them
+ * with a single commit. Nothing is written if any record is invalid
+ * @param tlv: records of field id, value length and value
+ * @param length: total length of the records
+ * @return 0 on success, -1 on malformed records, -2 if a record is rejected
+ * by the schema or a validator, -3 if the commit fails
+ */
+int config_apply_tlv(const uint8_t *tlv, size_t length);
+
+/**
+ * @brief Apply a full configuration image as produced by config dump: the
+ * header and CRC are checked, then the records are applied as with
+ * config_apply_tlv()
+ * @return 0 on success, -4 on an invalid header or CRC, otherwise as
+ * config_apply_tlv()
+ */
+int config_apply_image(const uint8_t *image, size_t length);
+
+/**
+ * @brief Check whether a buffer starts with a configuration image header
+ */
+bool config_is_image(const uint8_t *buffer, size_t length);
+
+/**
+ * @brief CRC-32 of the committed configuration image, as stored in its tail
+ */
+uint32_t config_crc();
 
 #endif // __CONFIG_H__
@@ -32,45 +32,46 @@
 #ifndef __PACKET_H__
 #define __PACKET_H__
 
-#include "uwb.h"
-
-#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
-#define MAC80215_PACKET_SIZE (sizeof(mac_packet_t))
-#define MAC802154_PACKET_HEADER_SIZE 21
-#define MAC80215_PACKET_PAYLOAD_SIZE 128
-#define MAC80215_PACKET_TAIL_SIZE 2
+#define MAC802154_FRAME_SIZE_MAX 127
+#define MAC802154_FRAME_CONTROL_SIZE 2
+#define MAC802154_SEQUENCE_NUMBER_SIZE 1
+#define MAC802154_PAN_ID_SIZE 2
+#define MAC802154_SHORT_ADDRESS_SIZE 2
+#define MAC802154_EXTENDED_ADDRESS_SIZE 8
+#define MAC802154_FCS_SIZE 2
+#define MAC802154_HEADER_SIZE_MAX (MAC802154_FRAME_CONTROL_SIZE +      \
+                                   MAC802154_SEQUENCE_NUMBER_SIZE +    \
+                                   2 * MAC802154_PAN_ID_SIZE +         \
+                                   2 * MAC802154_EXTENDED_ADDRESS_SIZE)
+#define MAC802154_PAYLOAD_SIZE_MAX (MAC802154_FRAME_SIZE_MAX - MAC802154_FRAME_CONTROL_SIZE - \
+                                    MAC802154_SEQUENCE_NUMBER_SIZE - MAC802154_FCS_SIZE)
 
-// Packet format with compressed PAN and 64Bit addresses
-// Maximum 128 bytes payload
-typedef struct __packed
-{
-    union {
-        uint16_t raw;
-        struct
-        {
-            uint16_t frame_type : 3;
-            uint16_t security_enabled : 1;
-            uint16_t frame_pending : 1;
-            uint16_t ack_required : 1;
-            uint16_t pan_id : 1;
-            uint16_t reserved : 3;
-            uint16_t dest_addr_mode : 2;
-            uint16_t frame_version : 2;
-            uint16_t src_addr_mode : 2;
-        } fields;
-    } frame_control;
+#define MAC802154_BROADCAST_PAN_ID 0xFFFF
+#define MAC802154_BROADCAST_ADDRESS 0xFFFF
 
-    uint8_t sequence_number;
-    uint16_t dest_pan_id;
-    uint8_t dest_address[8];
-    uint8_t src_address[8];
+typedef union
+{
+    uint16_t raw;
+    struct
+    {
+        uint16_t frame_type : 3;
+        uint16_t security_enabled : 1;
+        uint16_t frame_pending : 1;
+        uint16_t ack_required : 1;
+        uint16_t pan_id : 1;
+        uint16_t reserved : 3;
+        uint16_t dest_addr_mode : 2;
+        uint16_t frame_version : 2;
+        uint16_t src_addr_mode : 2;
+    } fields;
+} mac_frame_control_t;
 
-    uint8_t payload[MAC80215_PACKET_PAYLOAD_SIZE];
-    uint8_t deca_checksum[2];
-} mac_packet_t;
+_Static_assert(sizeof(mac_frame_control_t) == MAC802154_FRAME_CONTROL_SIZE, "Frame control must be 2 bytes");
 
 typedef enum
 {
@@ -80,43 +81,111 @@ typedef enum
     MAC802154_TYPE_CMD
 } mac_packet_type_t;
 
+typedef enum
+{
+    MAC802154_ADDR_MODE_NONE = 0,
+    MAC802154_ADDR_MODE_SHORT = 2,
+    MAC802154_ADDR_MODE_EXTENDED = 3
+} mac_addr_mode_t;
+
+typedef struct
+{
+    mac_addr_mode_t mode;
+    union {
+        uint16_t short_address;
+        uint8_t extended_address[MAC802154_EXTENDED_ADDRESS_SIZE];
+    };
+} mac_address_t;
+
+/**
+ * @brief Decoded view of a variable length 802.15.4 frame
+ *
+ * When building, payload points at the caller's payload. When parsing, payload
+ * points into the receive buffer, so the buffer must outlive the frame.
+ */
+typedef struct
+{
+    mac_packet_type_t type;
+    uint8_t sequence_number;
+    bool pan_id_compression;
+    uint16_t dest_pan_id;
+    uint16_t src_pan_id;
+    mac_address_t dest;
+    mac_address_t src;
+    uint8_t *payload;
+    uint8_t payload_length;
+} mac_frame_t;
+
 /**
- * @brief Initialize packet header
- * @param packet: pointer to mac_packet_t packet
- * @param type: mac_packet_type_t type
+ * @brief Initialize a data frame with PAN compression, broadcast short destination
+ * and short source address
+ * @param frame: pointer to mac_frame_t frame
+ * @param pan: PAN id
+ * @param src_short_address: 16 bit source address
  */
-#define MAC80215_PACKET_INIT(packet, type)                   \
-    do                                                       \
-    {                                                        \
-        (packet)->frame_control.fields.frame_type = (type);  \
-        (packet)->frame_control.fields.security_enabled = 0; \
-        (packet)->frame_control.fields.frame_pending = 0;    \
-        (packet)->frame_control.fields.ack_required = 0;     \
-        (packet)->frame_control.fields.pan_id = 1;           \
-        (packet)->frame_control.fields.dest_addr_mode = 3;   \
-        (packet)->frame_control.fields.frame_version = 1;    \
-        (packet)->frame_control.fields.src_addr_mode = 3;    \
+#define MAC802154_FRAME_INIT(frame, pan, src_short_address)         \
+    do                                                              \
+    {                                                               \
+        memset((frame), 0, sizeof(mac_frame_t));                    \
+        (frame)->type = MAC802154_TYPE_DATA;                        \
+        (frame)->pan_id_compression = true;                         \
+        (frame)->dest_pan_id = (pan);                               \
+        (frame)->src_pan_id = (pan);                                \
+        (frame)->dest.mode = MAC802154_ADDR_MODE_SHORT;             \
+        (frame)->dest.short_address = MAC802154_BROADCAST_ADDRESS;  \
+        (frame)->src.mode = MAC802154_ADDR_MODE_SHORT;              \
+        (frame)->src.short_address = (src_short_address);           \
     } while (0)
 
 /**
- * @brief LOG_DBG packet contents
- * @param packet: pointer to mac_packet_t packet
+ * @brief LOG_DBG frame contents
+ * @param frame: pointer to mac_frame_t frame
+ */
+#define MAC802154_LOG_FRAME(frame)                                                \
+    LOG_DBG("frame_type: %u", (frame)->type);                                     \
+    LOG_DBG("sequence_number: %u", (frame)->sequence_number);                     \
+    LOG_DBG("pan_id_compression: %u", (frame)->pan_id_compression);               \
+    LOG_DBG("dest_pan_id: %x", (frame)->dest_pan_id);                             \
+    LOG_DBG("dest_addr_mode: %u", (frame)->dest.mode);                            \
+    LOG_DBG("src_addr_mode: %u", (frame)->src.mode);                              \
+    LOG_HEXDUMP_DBG(&(frame)->dest.short_address, 8, "dest_address");            \
+    LOG_HEXDUMP_DBG(&(frame)->src.short_address, 8, "src_address");               \
+    LOG_HEXDUMP_DBG((frame)->payload, (frame)->payload_length, "payload");
+
+/**
+ * @brief Size of the MAC header for the given frame
+ * @param frame: frame
+ * @return header size in bytes
+ */
+size_t mac_frame_header_size(const mac_frame_t *frame);
+
+/**
+ * @brief Serialize frame into buffer as header + payload, reserving room for the FCS
+ * which the DW1000 appends on transmit
+ * @param frame: frame to serialize
+ * @param buffer: output buffer
+ * @param size: size of output buffer
+ * @return total frame length including FCS (as expected by dwt_writetxdata), or negative on error
+ */
+int mac_frame_write(const mac_frame_t *frame, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Parse a received frame. Payload points into buffer
+ * @param frame: decoded frame
+ * @param buffer: received bytes
+ * @param length: received length including FCS
+ * @return 0 on success, negative on malformed frame
  */
-#define MAC80215_LOG_PACKET(packet)                                                   \
-    LOG_DBG("frame_type: %u", (packet)->frame_control.fields.frame_type);             \
-    LOG_DBG("security_enabled: %u", (packet)->frame_control.fields.security_enabled); \
-    LOG_DBG("frame_pending: %u", (packet)->frame_control.fields.frame_pending);       \
-    LOG_DBG("ack_required: %u", (packet)->frame_control.fields.ack_required);         \
-    LOG_DBG("pan_id: %u", (packet)->frame_control.fields.pan_id);                     \
-    LOG_DBG("reserved: %u", (packet)->frame_control.fields.reserved);                 \
-    LOG_DBG("dest_addr_mode: %u", (packet)->frame_control.fields.dest_addr_mode);     \
-    LOG_DBG("frame_version: %u", (packet)->frame_control.fields.frame_version);       \
-    LOG_DBG("src_addr_mode: %u", (packet)->frame_control.fields.src_addr_mode);       \
-    LOG_DBG("sequence_number: %u", (packet)->sequence_number);                        \
-    LOG_DBG("dest_pan_id: %u", (packet)->dest_pan_id);                                \
-    LOG_HEXDUMP_DBG((packet)->dest_address, 8, "dest_address");                       \
-    LOG_HEXDUMP_DBG((packet)->src_address, 8, "src_address");                         \
-    LOG_HEXDUMP_DBG((packet)->payload, MAC80215_PACKET_PAYLOAD_SIZE, "payload");      \
-    LOG_HEXDUMP_DBG((packet)->deca_checksum, 2, "deca_checksum");
+int mac_frame_read(mac_frame_t *frame, uint8_t *buffer, size_t length);
+
+/**
+ * @brief Derive the 16 bit short address from an 8 byte extended address
+ * @param address: extended address as entered in configuration
+ * @return short address (last two bytes)
+ */
+static inline uint16_t mac_short_address(const uint8_t *address)
+{
+    return ((uint16_t)address[6] << 8) | address[7];
+}
 
 #endif // PACKET_H
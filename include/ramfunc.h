@@ -1,5 +1,5 @@
 /**
- * @file uwb_utils.h
+ * @file ramfunc.h
  * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
  * @brief
  * @version 1.0.0
@@ -29,11 +29,15 @@
  *
  */
 
-#ifndef __UWB_UTILS__
-#define __UWB_UTILS__
+#ifndef __RAMFUNC_H__
+#define __RAMFUNC_H__
 
-#include <stdint.h>
+// Places a function on the radio hot path in RAM with CONFIG_TDOA_RAMFUNC
+#ifdef CONFIG_TDOA_RAMFUNC
+#include <zephyr/linker/section_tags.h>
+#define TDOA_RAMFUNC __ramfunc
+#else
+#define TDOA_RAMFUNC
+#endif
 
-uint64_t uwb_utils_timestamp_to_u64(uint8_t *timestamp_buffer);
-
-#endif // __UWB_UTILS__
\ No newline at end of file
+#endif // __RAMFUNC_H__
@@ -0,0 +1,109 @@
+/**
+ * @file telemetry.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TELEMETRY_MAGIC 0xC1A0
+#define TELEMETRY_HEADER_SIZE 5
+#define TELEMETRY_CRC_SIZE 4
+#define TELEMETRY_RECORD_SIZE(payload_length) (TELEMETRY_HEADER_SIZE + (payload_length) + TELEMETRY_CRC_SIZE)
+
+typedef enum
+{
+    TELEMETRY_RECORD_CIR = 1,
+    TELEMETRY_RECORD_EVENTS,
+} telemetry_record_t;
+
+typedef struct
+{
+    uint32_t records;
+    uint32_t dropped;
+    uint32_t streamed_bytes;
+} telemetry_stats_t;
+
+#ifdef CONFIG_TDOA_TELEMETRY
+
+/**
+ * @brief Start the streaming thread
+ * @return 0 on success, -1 if no telemetry UART is chosen and the console
+ * fallback is disabled, -2 if the UART is not ready
+ */
+int telemetry_init();
+
+/**
+ * @brief Queue a record for streaming. Fills in the header and CRC around the
+ * payload. Never waits for the UART, safe to call from any thread
+ * @param type: record type
+ * @param record: buffer of TELEMETRY_RECORD_SIZE(payload_length) bytes with
+ * the payload at offset TELEMETRY_HEADER_SIZE
+ * @param payload_length: payload length in bytes
+ * @return 0 on success, negative if the record was dropped because the ring
+ * buffer is full or telemetry is not streamed
+ */
+int telemetry_send(telemetry_record_t type, uint8_t *record, uint16_t payload_length);
+
+void telemetry_stats(telemetry_stats_t *stats);
+
+/**
+ * @brief Whether records are streamed, so producers can skip work whose
+ * result would only be dropped
+ */
+bool telemetry_streaming();
+
+#else
+
+static inline int telemetry_init()
+{
+    return 0;
+}
+
+static inline int telemetry_send(telemetry_record_t type, uint8_t *record, uint16_t payload_length)
+{
+    return -1;
+}
+
+static inline void telemetry_stats(telemetry_stats_t *stats)
+{
+    *stats = (telemetry_stats_t){0};
+}
+
+static inline bool telemetry_streaming()
+{
+    return false;
+}
+
+#endif // CONFIG_TDOA_TELEMETRY
+
+#endif // __TELEMETRY_H__
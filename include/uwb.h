@@ -33,20 +33,38 @@
 #define __UWB_H__
 
 #include "config.h"
+#include "deca_device_api.h"
+#include "mac.h"
+#include "uwb_rx_quality.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define UWB_TIMEOUT_MAXIMUM 0xFFFFFFFFUL;
 #define UWB_PAN_ID 0xBEEF
 
+// Header and FCS of a frame with short addresses and a compressed PAN ID
+#define UWB_FRAME_OVERHEAD (MAC802154_FRAME_CONTROL_SIZE + MAC802154_SEQUENCE_NUMBER_SIZE + \
+                            MAC802154_PAN_ID_SIZE + 2 * MAC802154_SHORT_ADDRESS_SIZE +     \
+                            MAC802154_FCS_SIZE)
+#define UWB_PAYLOAD_SIZE_MAX (MAC802154_FRAME_SIZE_MAX - UWB_FRAME_OVERHEAD)
+
 typedef struct
 {
     uint8_t mode;
     uint8_t address[8];
+    uint16_t short_address;
     uint32_t anchor_x_pos_mm;
     uint32_t anchor_y_pos_mm;
+    uint32_t anchor_z_pos_mm;
+    uint16_t tx_antenna_delay;
+    uint16_t rx_antenna_delay;
+    uint8_t phy_profile;
+    uint16_t sync_interval_ms;
+    uint8_t anchor_count;
+    uint8_t xtal_trim;
 } uwb_config_t;
 
 typedef enum
@@ -69,20 +87,141 @@ typedef enum
 typedef enum
 {
     UWB_PACKET_TYPE_SYNC = 0,
+    UWB_PACKET_TYPE_SYNC_POSITION,
+    UWB_PACKET_TYPE_BLINK,
+    UWB_PACKET_TYPE_TIMESTAMP_REPORT,
+    UWB_PACKET_TYPE_CONFIG,
+    UWB_PACKET_TYPE_CLOCK_MODEL,
+    UWB_PACKET_TYPE_ANCHOR_INFO,
     UWB_PACKET_TYPE_MAX
 } uwb_packet_type_t;
 
 _Static_assert(UWB_PACKET_TYPE_MAX < 8, "Too many uwb packet types");
 
+typedef struct
+{
+    mac_frame_t mac;
+    uint64_t rx_timestamp;
+    uwb_rx_quality_t quality;
+    // Receive diagnostics as read with CONFIG_TDOA_RX_DIAGNOSTICS
+    dwt_rxdiag_t diag;
+    // Preamble accumulation count without saturation, to correct diag.rxPreamCount
+    uint16_t rxpacc_nosat;
+    // Frame length including FCS as reported by the DW1000
+    uint32_t length;
+    uint8_t buffer[MAC802154_FRAME_SIZE_MAX];
+} uwb_rx_frame_t;
+
 typedef struct
 {
     void (*init)(uwb_config_t *config);
     uint32_t (*on_event)(uwb_event_t event);
 } uwb_algorithm_t;
 
+/**
+ * @brief Start the uwb thread, which brings up the DW1000 in the background
+ * @return 0 on success
+ */
 int uwb_init();
-void uwb_start();
+
+/**
+ * @brief Wait for the radio to be initialized, load the uwb configuration and
+ * start the algorithm of the configured mode. Call after config_init()
+ * @return 0 on success, negative if the radio failed to initialize
+ */
+int uwb_start();
 int uwb_mode_count();
+
+/**
+ * @brief Check whether the algorithm of a mode is built into this image
+ */
+bool uwb_mode_available(uwb_mode_t mode);
 char *uwb_mode_name(uwb_mode_t mode);
 
+/**
+ * @brief Short address currently used by this node
+ */
+uint16_t uwb_short_address();
+
+/**
+ * @brief Latest pair of simultaneous DW1000 and MCU times: the end of the last
+ * received frame and the hardware timestamp of its interrupt edge. Only
+ * available with CONFIG_TDOA_IRQ_CAPTURE
+ * @param device_time: DW1000 system time in device ticks
+ * @param mcu_ticks: capture timer ticks at PORT_IRQ_CAPTURE_HZ
+ * @return 0 on success, negative if no frame was captured
+ */
+int uwb_time_correlation(uint64_t *device_time, uint32_t *mcu_ticks);
+
+/**
+ * @brief Calibrate the crystal trim against a reference anchor. The uwb
+ * thread suspends the current algorithm and listens to the reference, adjusts
+ * the trim until the mean frequency offset over each batch of frames is within
+ * half a trim step, stores the result as xtal_trim and resumes the algorithm.
+ * Progress is reported by uwb_xtal_status()
+ * @param reference: short address of the reference anchor
+ * @param frames: frames from the reference averaged per trim step
+ * @return 0 on success, -1 if a calibration is already running, -2 if the
+ * radio is not running
+ */
+int uwb_calibrate_xtal(uint16_t reference, uint16_t frames);
+
+/**
+ * @brief Enable the receiver immediately. Algorithms use this instead of
+ * dwt_rxenable so the interrupt to RX re-enable latency is measured
+ * @return 0 on success, negative on error
+ */
+int uwb_rx_enable(void);
+
+/**
+ * @brief Serialize frame and load it into the DW1000 TX buffer. Only the
+ * actual frame length is written over SPI and sent over the air. The frame
+ * is stamped with the next sequence number of the current mode
+ * @param frame: frame to transmit
+ * @return frame length including FCS, or negative on error
+ */
+int uwb_write_frame(mac_frame_t *frame);
+
+/**
+ * @brief Start transmitting the frame loaded by uwb_write_frame(). Frames
+ * queued with uwb_send() are held back until it is sent, so that they do not
+ * cancel a delayed transmission
+ * @param mode: DWT_START_TX_IMMEDIATE or DWT_START_TX_DELAYED, optionally
+ * with DWT_RESPONSE_EXPECTED
+ * @return 0 on success, negative if the DW1000 rejected the request
+ */
+int uwb_start_tx(uint8_t mode);
+
+/**
+ * @brief Read the received frame and its RX timestamp from the DW1000 and parse it.
+ * With CONFIG_TDOA_RX_DIAGNOSTICS the receive diagnostics are read along with
+ * the timestamp. Only reads and parses, so that it can run from RAM before the
+ * receiver is re-enabled; pass the result to uwb_process_frame() afterwards
+ * @param rx: frame descriptor, mac payload points into rx->buffer
+ * @return 0 on success, -1 if the frame is too long, -2 if it is malformed
+ */
+int uwb_read_frame(uwb_rx_frame_t *rx);
+
+/**
+ * @brief Finish a frame read by uwb_read_frame(), best once the receiver runs
+ * again: log a read error, or compute the receive quality of a valid frame,
+ * account it in the per-source statistics and offer it for CIR capture
+ * @param rx: frame descriptor filled by uwb_read_frame()
+ * @param ret: return value of uwb_read_frame()
+ * @return ret
+ */
+int uwb_process_frame(uwb_rx_frame_t *rx, int ret);
+
+/**
+ * @brief Queue a frame for transmission by the uwb thread. It is sent as soon
+ * as the thread wakes up, interrupting any reception, or after the TX done
+ * event of a frame the algorithm started with uwb_start_tx(). Safe to call
+ * from any thread
+ * @param dest_address: short destination address
+ * @param payload: frame payload, copied
+ * @param length: payload length, at most UWB_PAYLOAD_SIZE_MAX
+ * @return 0 on success, negative if the payload is too long or the queue is full
+ */
+int uwb_send(uint16_t dest_address, const uint8_t *payload, uint8_t length);
+
 #endif // UWB_H
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file uwb_airtime.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_AIRTIME_H__
+#define __UWB_AIRTIME_H__
+
+#include "deca_device_api.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Reed-Solomon adds 48 parity bits to each block of up to 330 data bits
+#define UWB_AIRTIME_RS_BLOCK_BITS 330
+#define UWB_AIRTIME_RS_PARITY_BITS 48
+
+// Idle time around each anchor slot for TX/RX turnaround and scheduling jitter
+#define UWB_AIRTIME_SLOT_GUARD_NS 100000
+// Worst case crystal offset between two anchors, each at +-20 ppm
+#define UWB_AIRTIME_DRIFT_PPM 40
+
+typedef struct
+{
+    uint32_t preamble_ns;
+    uint32_t sfd_ns;
+    uint32_t phr_ns;
+    uint32_t payload_ns;
+    uint32_t total_ns;
+} uwb_airtime_t;
+
+/**
+ * @brief Data symbols of a frame, one per bit plus the Reed-Solomon parity
+ * @param frame_length: MAC frame length including FCS
+ */
+static inline uint32_t uwb_airtime_payload_symbols(size_t frame_length)
+{
+    const uint32_t data_bits = frame_length * 8;
+    const uint32_t blocks = (data_bits + UWB_AIRTIME_RS_BLOCK_BITS - 1) / UWB_AIRTIME_RS_BLOCK_BITS;
+
+    return data_bits + blocks * UWB_AIRTIME_RS_PARITY_BITS;
+}
+
+/**
+ * @brief Duration of a data symbol in picoseconds. The PHY header uses the
+ * same symbols, except at 6.8 Mbps where it is sent at 850 kbps
+ * @param config: PHY configuration
+ */
+uint32_t uwb_airtime_data_symbol_ps(const dwt_config_t *config);
+
+/**
+ * @brief Time on air of each part of a frame
+ * @param config: PHY configuration
+ * @param frame_length: MAC frame length including FCS
+ * @param airtime: durations in nanoseconds
+ */
+void uwb_airtime_frame(const dwt_config_t *config, size_t frame_length, uwb_airtime_t *airtime);
+
+/**
+ * @brief Time on air of a frame in nanoseconds
+ * @param config: PHY configuration
+ * @param frame_length: MAC frame length including FCS
+ */
+uint32_t uwb_airtime_frame_ns(const dwt_config_t *config, size_t frame_length);
+
+/**
+ * @brief Length of one anchor slot: the longest anchor frame, an anchor_info
+ * carrying a configuration acknowledgement, plus the guard time
+ * @param config: PHY configuration
+ */
+uint32_t uwb_airtime_slot_ns(const dwt_config_t *config);
+
+/**
+ * @brief Shortest sync interval at which every anchor gets its own slot
+ * without overlapping the others, including the drift between anchors
+ * accumulated over the interval
+ * @param config: PHY configuration
+ * @param anchor_count: number of anchors sharing the channel
+ * @return interval in microseconds
+ */
+uint32_t uwb_airtime_min_sync_interval_us(const dwt_config_t *config, uint32_t anchor_count);
+
+/**
+ * @brief Check that anchor_count anchors fit in a sync interval
+ * @return 0 if they fit, negative if the channel is oversubscribed
+ */
+int uwb_airtime_check(const dwt_config_t *config, uint32_t anchor_count, uint32_t sync_interval_ms);
+
+#endif // __UWB_AIRTIME_H__
@@ -0,0 +1,120 @@
+/**
+ * @file uwb_cir.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_CIR_H__
+#define __UWB_CIR_H__
+
+#include "deca_device_api.h"
+#include "uwb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UWB_CIR_SOURCE_ANY 0xFFFF
+// Bytes per accumulator tap: 16 bit real and imaginary part
+#define UWB_CIR_TAP_SIZE 4
+
+typedef struct
+{
+    bool enabled;
+    // short source address, UWB_CIR_SOURCE_ANY for every source
+    uint16_t source;
+    uint16_t taps;
+    // capture one of every this many matching frames
+    uint16_t every;
+    uint32_t captured;
+    uint32_t dropped;
+    // windows discarded because the next frame started before they were read
+    uint32_t overwritten;
+} uwb_cir_status_t;
+
+#ifdef CONFIG_TDOA_CIR_CAPTURE
+
+/**
+ * @brief Capture the CIR window around the first path of matching frames
+ * @param source: short source address, UWB_CIR_SOURCE_ANY for every source
+ * @param taps: window length, 1 to CONFIG_TDOA_CIR_TAPS_MAX
+ * @param every: capture one of every this many matching frames, at least 1
+ * @return 0 on success, negative on invalid arguments
+ */
+int uwb_cir_start(uint16_t source, uint16_t taps, uint16_t every);
+
+/**
+ * @brief Stop capturing. Records already captured are still streamed
+ */
+void uwb_cir_stop();
+
+void uwb_cir_status(uwb_cir_status_t *status);
+
+/**
+ * @brief Select a received frame for capture and record its metadata. Does
+ * nothing unless telemetry is streaming. The window is read later by
+ * uwb_cir_flush(), off the receive path
+ * @param rx: parsed frame with valid receive quality
+ * @param diag: diagnostics of the frame
+ */
+void uwb_cir_capture(const uwb_rx_frame_t *rx, const dwt_rxdiag_t *diag);
+
+/**
+ * @brief Read the window of the selected frame and stream it as telemetry.
+ * Call from the uwb thread after the algorithm has handled the frame and
+ * re-enabled the receiver. The window is discarded if a new preamble has
+ * been detected since, and dropped if the telemetry buffer is full
+ */
+void uwb_cir_flush();
+
+#else
+
+static inline int uwb_cir_start(uint16_t source, uint16_t taps, uint16_t every)
+{
+    return -1;
+}
+
+static inline void uwb_cir_stop()
+{
+}
+
+static inline void uwb_cir_status(uwb_cir_status_t *status)
+{
+    *status = (uwb_cir_status_t){0};
+}
+
+static inline void uwb_cir_capture(const uwb_rx_frame_t *rx, const dwt_rxdiag_t *diag)
+{
+}
+
+static inline void uwb_cir_flush()
+{
+}
+
+#endif // CONFIG_TDOA_CIR_CAPTURE
+
+#endif // __UWB_CIR_H__
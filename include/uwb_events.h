@@ -0,0 +1,106 @@
+/**
+ * @file uwb_events.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_EVENTS_H__
+#define __UWB_EVENTS_H__
+
+#include <stdint.h>
+
+typedef enum
+{
+    UWB_EVC_PHR_ERROR = 0,
+    UWB_EVC_RS_SYNC_LOSS,
+    UWB_EVC_FCS_GOOD,
+    UWB_EVC_FCS_ERROR,
+    UWB_EVC_FILTER_REJECT,
+    UWB_EVC_OVERRUN,
+    UWB_EVC_SFD_TIMEOUT,
+    UWB_EVC_PREAMBLE_TIMEOUT,
+    UWB_EVC_FRAME_WAIT_TIMEOUT,
+    UWB_EVC_TX_FRAME,
+    UWB_EVC_HALF_PERIOD_WARNING,
+    UWB_EVC_POWER_UP_WARNING,
+    UWB_EVC_MAX
+} uwb_evc_t;
+
+typedef struct
+{
+    // events since start or the last reset
+    uint32_t total[UWB_EVC_MAX];
+    // events in the last sample period
+    uint16_t last[UWB_EVC_MAX];
+    // events per second in the last sample period, times 100
+    uint32_t rate_x100[UWB_EVC_MAX];
+    uint32_t period_ms;
+    uint32_t samples;
+} uwb_events_t;
+
+#ifdef CONFIG_TDOA_EVENT_COUNTERS
+
+/**
+ * @brief Enable the DW1000 event counters and start sampling them every
+ * CONFIG_TDOA_EVENT_COUNTERS_PERIOD_MS. Call with the DW1000 lock held
+ */
+void uwb_events_start();
+
+/**
+ * @brief Copy the counters and the rates of the last sample period
+ * @return 0 on success, negative if no period has been sampled yet
+ */
+int uwb_events_read(uwb_events_t *events);
+
+void uwb_events_reset();
+
+const char *uwb_events_name(uwb_evc_t counter);
+
+#else
+
+static inline void uwb_events_start()
+{
+}
+
+static inline int uwb_events_read(uwb_events_t *events)
+{
+    return -1;
+}
+
+static inline void uwb_events_reset()
+{
+}
+
+static inline const char *uwb_events_name(uwb_evc_t counter)
+{
+    return "";
+}
+
+#endif // CONFIG_TDOA_EVENT_COUNTERS
+
+#endif // __UWB_EVENTS_H__
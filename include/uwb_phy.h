@@ -0,0 +1,92 @@
+/**
+ * @file uwb_phy.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_PHY_H__
+#define __UWB_PHY_H__
+
+#include "deca_device_api.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum
+{
+    UWB_PHY_PROFILE_SHORT = 0,
+    UWB_PHY_PROFILE_DEFAULT,
+    UWB_PHY_PROFILE_LONG,
+    UWB_PHY_PROFILE_MAX
+} uwb_phy_profile_t;
+
+typedef struct
+{
+    const char *name;
+    const char *description;
+    dwt_config_t config;
+    dwt_txconfig_t tx;
+    bool smart_tx_power;
+} uwb_phy_profile_desc_t;
+
+/**
+ * @brief Get the description of a profile
+ * @return NULL for unknown profiles
+ */
+const uwb_phy_profile_desc_t *uwb_phy_profile(uwb_phy_profile_t profile);
+
+/**
+ * @brief Look up a profile by name
+ * @return profile on success, negative if no profile has that name
+ */
+int uwb_phy_profile_by_name(const char *name);
+
+/**
+ * @brief Profile currently configured in the DW1000
+ */
+uwb_phy_profile_t uwb_phy_current();
+
+/**
+ * @brief Configure the DW1000 for a profile: channel, preamble, PAC, SFD,
+ * data rate and TX power. The transceiver must be idle, call from the uwb
+ * thread only
+ * @return 0 on success, negative for unknown profiles
+ */
+int uwb_phy_apply(uwb_phy_profile_t profile);
+
+/**
+ * @brief Time from the RX timestamp at the start of the PHY header to the end
+ * of a frame with the applied profile, from durations cached by
+ * uwb_phy_apply() so that the receive path does no airtime arithmetic
+ * @param frame_length: MAC frame length including FCS
+ * @return duration in DW1000 ticks
+ */
+uint32_t uwb_phy_rx_end_ticks(size_t frame_length);
+
+#endif // __UWB_PHY_H__
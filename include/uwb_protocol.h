@@ -0,0 +1,197 @@
+/**
+ * @file uwb_protocol.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_PROTOCOL_H__
+#define __UWB_PROTOCOL_H__
+
+#include "uwb.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+#define UWB_PROTOCOL_VERSION 1
+
+#define UWB_TIMESTAMP_SIZE 5
+
+#define UWB_BLINK_FLAG_INFO_REQUEST (1 << 0)
+
+#define UWB_CLOCK_QUALITY_UNKNOWN 0
+
+/*
+ * Every message starts with a one byte header carrying the message type in
+ * the low 3 bits and the protocol version in the high 5 bits. All messages are
+ * packed little-endian and are read in place from the receive buffer.
+ */
+typedef struct __packed
+{
+    uint8_t type : 3;
+    uint8_t version : 5;
+} uwb_msg_header_t;
+
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint8_t tx_timestamp[UWB_TIMESTAMP_SIZE];
+} uwb_msg_sync_t;
+
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint8_t tx_timestamp[UWB_TIMESTAMP_SIZE];
+    uint32_t x_pos_mm;
+    uint32_t y_pos_mm;
+} uwb_msg_sync_position_t;
+
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint8_t flags;
+} uwb_msg_blink_t;
+
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint16_t tag_address;
+    uint8_t tag_sequence_number;
+    uint8_t rx_timestamp[UWB_TIMESTAMP_SIZE];
+} uwb_msg_timestamp_report_t;
+
+/*
+ * Configuration update for one node or, with the broadcast address, every
+ * node. The TLV records use the layout of the configuration store and are
+ * followed by a CRC-16/CCITT over target_address up to the last TLV byte.
+ */
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint16_t target_address;
+    uint16_t sequence;
+    uint8_t tlv_length;
+    uint8_t tlv[];
+} uwb_msg_config_t;
+
+/*
+ * Optional acknowledgement of a configuration update, appended after a sync,
+ * sync_position, anchor_info or blink message.
+ */
+typedef struct __packed
+{
+    uint16_t sequence;
+    int8_t status;
+} uwb_msg_config_ack_t;
+
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint16_t reference_address;
+    uint8_t reference_timestamp[UWB_TIMESTAMP_SIZE];
+    uint8_t local_timestamp[UWB_TIMESTAMP_SIZE];
+    int32_t drift_ppb;
+} uwb_msg_clock_model_t;
+
+/*
+ * Slow changing anchor metadata. Sent in place of a plain sync every Nth
+ * superframe or when requested, so it starts with the same layout as
+ * uwb_msg_sync_t and still carries timing.
+ */
+typedef struct __packed
+{
+    uwb_msg_header_t header;
+    uint8_t tx_timestamp[UWB_TIMESTAMP_SIZE];
+    uint32_t x_pos_mm;
+    uint32_t y_pos_mm;
+    uint8_t phy_profile;
+    uint8_t clock_quality;
+} uwb_msg_anchor_info_t;
+
+_Static_assert(sizeof(uwb_msg_header_t) == 1, "uwb message header must be 1 byte");
+_Static_assert(sizeof(uwb_msg_sync_t) == 6, "uwb_msg_sync_t size changed");
+_Static_assert(sizeof(uwb_msg_sync_position_t) == 14, "uwb_msg_sync_position_t size changed");
+_Static_assert(sizeof(uwb_msg_blink_t) == 2, "uwb_msg_blink_t size changed");
+_Static_assert(sizeof(uwb_msg_timestamp_report_t) == 9, "uwb_msg_timestamp_report_t size changed");
+_Static_assert(sizeof(uwb_msg_config_t) == 6, "uwb_msg_config_t size changed");
+_Static_assert(sizeof(uwb_msg_config_ack_t) == 3, "uwb_msg_config_ack_t size changed");
+_Static_assert(sizeof(uwb_msg_clock_model_t) == 17, "uwb_msg_clock_model_t size changed");
+_Static_assert(sizeof(uwb_msg_anchor_info_t) == 16, "uwb_msg_anchor_info_t size changed");
+_Static_assert(UWB_PROTOCOL_VERSION < 32, "Protocol version must fit in 5 bits");
+
+/**
+ * @brief Message handler
+ * @param rx: received frame descriptor
+ * @param message: pointer to the message in rx->buffer, at least the minimum
+ * size of its type
+ */
+typedef void (*uwb_protocol_handler_t)(const uwb_rx_frame_t *rx, const void *message);
+
+/**
+ * @brief Initialize message header
+ * @param message: pointer to message struct
+ * @param message_type: uwb_packet_type_t type
+ */
+#define UWB_MESSAGE_INIT(message, message_type)                 \
+    do                                                          \
+    {                                                           \
+        memset((message), 0, sizeof(*(message)));               \
+        (message)->header.type = (message_type);                \
+        (message)->header.version = UWB_PROTOCOL_VERSION;       \
+    } while (0)
+
+/**
+ * @brief Minimum payload size of a message type
+ * @param type: message type
+ * @return size in bytes, 0 for unknown types
+ */
+size_t uwb_protocol_message_size(uwb_packet_type_t type);
+
+/**
+ * @brief Name of a message type
+ * @param type: message type
+ * @return name, "UNKNOWN" for unknown types
+ */
+const char *uwb_protocol_message_name(uwb_packet_type_t type);
+
+/**
+ * @brief Validate the payload of a received frame and call the handler for its type
+ * @param handlers: table of UWB_PACKET_TYPE_MAX handlers, NULL entries are ignored
+ * @param rx: received frame
+ * @return 0 if handled, 1 if no handler is registered, negative on invalid message
+ */
+int uwb_protocol_dispatch(const uwb_protocol_handler_t handlers[UWB_PACKET_TYPE_MAX], const uwb_rx_frame_t *rx);
+
+/**
+ * @brief Find the configuration acknowledgement appended to a received message
+ * @param rx: received frame with a valid message
+ * @return acknowledgement in rx->buffer, NULL if none is present
+ */
+const uwb_msg_config_ack_t *uwb_protocol_config_ack(const uwb_rx_frame_t *rx);
+
+#endif // __UWB_PROTOCOL_H__
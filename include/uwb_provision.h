@@ -0,0 +1,84 @@
+/**
+ * @file uwb_provision.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_PROVISION_H__
+#define __UWB_PROVISION_H__
+
+#include "config.h"
+#include "uwb.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Acknowledgement status, the return value of config_apply_tlv()
+#define UWB_PROVISION_STATUS_OK 0
+#define UWB_PROVISION_STATUS_INVALID -1
+#define UWB_PROVISION_STATUS_REJECTED -2
+#define UWB_PROVISION_STATUS_FLASH -3
+
+/**
+ * @brief Handler of UWB_PACKET_TYPE_CONFIG messages. Updates addressed to this
+ * node or broadcast are applied with a single configuration commit on the
+ * system work queue and acknowledged in the next outgoing sync or blink
+ */
+void uwb_provision_handle(const uwb_rx_frame_t *rx, const void *message);
+
+/**
+ * @brief Log a configuration acknowledgement appended to a received message
+ * @param rx: received frame with a valid message
+ */
+void uwb_provision_receive_ack(const uwb_rx_frame_t *rx);
+
+/**
+ * @brief Check whether an acknowledgement is waiting to be sent
+ */
+bool uwb_provision_ack_pending();
+
+/**
+ * @brief Append the pending acknowledgement to an outgoing message
+ * @param buffer: destination, directly after the message
+ * @param size: space left in the payload
+ * @return number of bytes appended, 0 if no acknowledgement is pending
+ */
+size_t uwb_provision_write_ack(uint8_t *buffer, size_t size);
+
+/**
+ * @brief Send a configuration update of one field
+ * @param target_address: short address of the node, or the broadcast address
+ * @param field: configuration field
+ * @param value: value in the layout of the schema
+ * @param size: value size
+ * @return sequence number of the update, negative on error
+ */
+int uwb_provision_send(uint16_t target_address, config_field_t field, const void *value, uint8_t size);
+
+#endif // __UWB_PROVISION_H__
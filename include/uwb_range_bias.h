@@ -0,0 +1,83 @@
+/**
+ * @file uwb_range_bias.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_RANGE_BIAS_H__
+#define __UWB_RANGE_BIAS_H__
+
+#include "deca_device_api.h"
+
+#include <stdint.h>
+
+/**
+ * The DW1000 range bias comes from the receive power: a stronger signal moves
+ * the leading edge detection earlier. The Decawave tables in
+ * deca_range_tables.c fold that curve into the range, using the power
+ * expected at each distance for the reference TX power, and are the only
+ * bias data in this tree. The lookup is therefore keyed by range alone. It
+ * over- or under-corrects when the TX power, antenna gain or NLOS loss move
+ * the receive power away from that expectation. Keying by the receive power
+ * of uwb_rx_quality_t would need the bias versus power curves of the
+ * DW1000 application notes, which are not available here
+ */
+
+// Range covered by one entry of the lookup table
+#define UWB_RANGE_BIAS_STEP_MM 250
+
+/**
+ * @brief Select the range bias table of a PHY configuration. Called by
+ * uwb_phy_apply for the active profile. The table is only built on the next
+ * lookup, so profile changes cost nothing while no range is corrected. Call
+ * from the uwb thread, like the lookups
+ * @param config: PHY configuration, only the channel and PRF are used
+ * @return 0 on success, negative for an unsupported channel
+ */
+int uwb_range_bias_init(const dwt_config_t *config);
+
+/**
+ * @brief Range bias of the active PHY profile, a single table lookup once the
+ * table of the selected configuration has been built
+ * @param range_mm: measured range in millimeters
+ * @return bias in millimeters with a resolution of 10 mm, subtract it from the
+ * measured range. 0 until a configuration has been selected
+ */
+int32_t uwb_range_bias_mm(int32_t range_mm);
+
+/**
+ * @brief Measured range corrected for the range bias of the active PHY profile
+ * @param range_mm: measured range in millimeters
+ * @return corrected range in millimeters
+ */
+static inline int32_t uwb_range_bias_correct_mm(int32_t range_mm)
+{
+    return range_mm - uwb_range_bias_mm(range_mm);
+}
+
+#endif // __UWB_RANGE_BIAS_H__
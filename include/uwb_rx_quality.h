@@ -0,0 +1,79 @@
+/**
+ * @file uwb_rx_quality.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_RX_QUALITY_H__
+#define __UWB_RX_QUALITY_H__
+
+#include "deca_device_api.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Difference between receive and first path power below which a frame is line of sight
+#define UWB_RX_QUALITY_LOS_CDB 600
+// Difference between receive and first path power above which a frame is not line of sight
+#define UWB_RX_QUALITY_NLOS_CDB 1000
+
+typedef struct
+{
+    bool valid;
+    // first path index, 10.6 bits fixed point
+    uint16_t first_path_index;
+    // estimated first path power in 0.01 dBm
+    int16_t first_path_power;
+    // estimated receive power in 0.01 dBm
+    int16_t rx_power;
+    // 0 for line of sight up to 100 for a blocked first path
+    uint8_t nlos_score;
+} uwb_rx_quality_t;
+
+/**
+ * @brief Correct the preamble accumulation count for SFD symbols. When RXPACC
+ * equals RXPACC_NOSAT the count includes part of the SFD, which is subtracted
+ * as given for the SFD length in the user manual 4.7.2
+ * @param rxpacc: preamble accumulation count from RX_FINFO
+ * @param rxpacc_nosat: the same count without saturation, DRX_CONF 0x2C
+ * @param config: PHY configuration of the frame
+ * @return preamble accumulation count for the power equations
+ */
+uint16_t uwb_rx_quality_preamble_count(uint16_t rxpacc, uint16_t rxpacc_nosat, const dwt_config_t *config);
+
+/**
+ * @brief Derive the receive quality of a frame from the DW1000 diagnostics
+ * (user manual 4.7). Uses integer arithmetic only
+ * @param diag: diagnostics of the frame with the preamble count corrected by
+ * uwb_rx_quality_preamble_count(), maxNoise is not used
+ * @param prf: pulse repetition frequency of the frame, DWT_PRF_16M or DWT_PRF_64M
+ * @param quality: receive quality, not valid if no preamble was accumulated
+ */
+void uwb_rx_quality_compute(const dwt_rxdiag_t *diag, uint8_t prf, uwb_rx_quality_t *quality);
+
+#endif // __UWB_RX_QUALITY_H__
@@ -0,0 +1,90 @@
+/**
+ * @file uwb_stats.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_STATS_H__
+#define __UWB_STATS_H__
+
+#include <stdint.h>
+
+#define UWB_STATS_MAX_SOURCES 32
+
+typedef struct
+{
+    uint16_t address;
+    uint8_t last_sequence_number;
+    uint32_t received;
+    uint32_t missed;
+    uint32_t out_of_order;
+    uint32_t duplicates;
+    uint32_t interval_us;
+    uint32_t jitter_us;
+    uint64_t last_rx_timestamp;
+    int64_t last_rx_ms;
+} uwb_stats_source_t;
+
+#ifdef CONFIG_TDOA_STATS
+
+/**
+ * @brief Account a received frame against its source
+ * @param address: short source address
+ * @param sequence_number: MAC sequence number
+ * @param rx_timestamp: DW1000 RX timestamp in device ticks
+ */
+void uwb_stats_record(uint16_t address, uint8_t sequence_number, uint64_t rx_timestamp);
+
+/**
+ * @brief Copy statistics of a source
+ * @param index: table index, 0 to UWB_STATS_MAX_SOURCES - 1
+ * @param source: copy of the entry
+ * @return 0 on success, negative if the index is unused
+ */
+int uwb_stats_read(int index, uwb_stats_source_t *source);
+
+void uwb_stats_reset();
+
+#else
+
+static inline void uwb_stats_record(uint16_t address, uint8_t sequence_number, uint64_t rx_timestamp)
+{
+}
+
+static inline int uwb_stats_read(int index, uwb_stats_source_t *source)
+{
+    return -1;
+}
+
+static inline void uwb_stats_reset()
+{
+}
+
+#endif // CONFIG_TDOA_STATS
+
+#endif // __UWB_STATS_H__
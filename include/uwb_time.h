@@ -0,0 +1,160 @@
+/**
+ * @file uwb_time.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_TIME_H__
+#define __UWB_TIME_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+/*
+ * DW1000 system time: a 40-bit counter at 128 * 499.2 MHz (~15.65 ps per
+ * tick) that wraps every ~17.2 s. Differences are only meaningful modulo
+ * 2^40, so never subtract raw timestamps, use the helpers below.
+ */
+#define UWB_TIME_BITS 40
+#define UWB_TIME_MASK ((1ULL << UWB_TIME_BITS) - 1)
+#define UWB_TIME_SIZE 5
+#define UWB_TIME_TICKS_PER_S 63897600000ULL
+
+// ps per tick is 78125 / 4992 exactly
+#define UWB_TIME_PS_NUM 78125
+#define UWB_TIME_PS_DEN 4992
+
+// Speed of light in mm per second
+#define UWB_TIME_SPEED_OF_LIGHT_MM_S 299792458000ULL
+
+/**
+ * @brief Read a 5-byte little-endian timestamp as received over the air or
+ * read from the DW1000
+ */
+static inline uint64_t uwb_time_unpack(const uint8_t *buffer)
+{
+    return ((uint64_t)buffer[4] << 32) | sys_get_le32(buffer);
+}
+
+/**
+ * @brief Write a timestamp as 5 little-endian bytes
+ */
+static inline void uwb_time_pack(uint64_t time, uint8_t *buffer)
+{
+    sys_put_le32((uint32_t)time, buffer);
+    buffer[4] = (uint8_t)(time >> 32);
+}
+
+static inline uint64_t uwb_time_add(uint64_t time, int64_t ticks)
+{
+    return (time + (uint64_t)ticks) & UWB_TIME_MASK;
+}
+
+/**
+ * @brief Ticks from earlier to later, assuming later is at most one wrap
+ * period ahead
+ */
+static inline uint64_t uwb_time_elapsed(uint64_t later, uint64_t earlier)
+{
+    return (later - earlier) & UWB_TIME_MASK;
+}
+
+/**
+ * @brief Signed difference a - b for timestamps less than half a wrap period
+ * (~8.6 s) apart
+ */
+static inline int64_t uwb_time_diff(uint64_t a, uint64_t b)
+{
+    // sign extend the 40-bit difference
+    return (int64_t)((a - b) << (64 - UWB_TIME_BITS)) >> (64 - UWB_TIME_BITS);
+}
+
+/**
+ * @brief Check whether a is later than b, see uwb_time_diff()
+ */
+static inline bool uwb_time_after(uint64_t a, uint64_t b)
+{
+    return uwb_time_diff(a, b) > 0;
+}
+
+static inline int64_t uwb_time_ticks_to_ps(int64_t ticks)
+{
+    return ticks * UWB_TIME_PS_NUM / UWB_TIME_PS_DEN;
+}
+
+static inline int64_t uwb_time_ps_to_ticks(int64_t ps)
+{
+    return ps * UWB_TIME_PS_DEN / UWB_TIME_PS_NUM;
+}
+
+static inline uint32_t uwb_time_ticks_to_us(uint64_t ticks)
+{
+    return ticks * UWB_TIME_PS_NUM / UWB_TIME_PS_DEN / 1000000;
+}
+
+static inline uint64_t uwb_time_us_to_ticks(uint32_t us)
+{
+    return (uint64_t)us * UWB_TIME_TICKS_PER_S / 1000000;
+}
+
+/**
+ * @brief Distance light travels in a number of ticks, for |ticks| below 2^34
+ * (~270 ms)
+ */
+static inline int64_t uwb_time_ticks_to_mm(int64_t ticks)
+{
+    return ticks * (int64_t)(UWB_TIME_SPEED_OF_LIGHT_MM_S / 1000) / (int64_t)(UWB_TIME_TICKS_PER_S / 1000);
+}
+
+static inline int64_t uwb_time_mm_to_ticks(int64_t mm)
+{
+    return mm * (int64_t)(UWB_TIME_TICKS_PER_S / 1000) / (int64_t)(UWB_TIME_SPEED_OF_LIGHT_MM_S / 1000);
+}
+
+/**
+ * @brief Convert a duration in device ticks to kernel hardware cycles
+ */
+static inline uint64_t uwb_time_ticks_to_cycles(uint64_t ticks)
+{
+    const uint64_t hz = sys_clock_hw_cycles_per_sec();
+    // split whole seconds off to keep the product within 64 bits
+    return ticks / UWB_TIME_TICKS_PER_S * hz + ticks % UWB_TIME_TICKS_PER_S * hz / UWB_TIME_TICKS_PER_S;
+}
+
+/**
+ * @brief Convert a duration in kernel hardware cycles to device ticks
+ */
+static inline uint64_t uwb_time_cycles_to_ticks(uint64_t cycles)
+{
+    const uint64_t hz = sys_clock_hw_cycles_per_sec();
+    return cycles / hz * UWB_TIME_TICKS_PER_S + cycles % hz * UWB_TIME_TICKS_PER_S / hz;
+}
+
+#endif // __UWB_TIME_H__
@@ -0,0 +1,97 @@
+/**
+ * @file uwb_xtal.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __UWB_XTAL_H__
+#define __UWB_XTAL_H__
+
+#include "deca_device_api.h"
+#include "uwb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Approximate frequency pull of one crystal trim step (DW1000 datasheet)
+#define UWB_XTAL_PPB_PER_STEP 1500
+// Offset below which no further trim step is taken
+#define UWB_XTAL_TOLERANCE_PPB (UWB_XTAL_PPB_PER_STEP / 2)
+#define UWB_XTAL_ITERATIONS_MAX 8
+// Calibration fails if the reference is not heard for this long
+#define UWB_XTAL_REFERENCE_TIMEOUT_MS 5000
+
+typedef enum
+{
+    UWB_XTAL_IDLE = 0,
+    UWB_XTAL_RUNNING,
+    UWB_XTAL_DONE,
+    UWB_XTAL_FAILED,
+} uwb_xtal_state_t;
+
+typedef struct
+{
+    uwb_xtal_state_t state;
+    uint16_t reference;
+    uint16_t frames;
+    uint8_t iteration;
+    uint8_t initial_trim;
+    int32_t initial_offset_ppb;
+    uint8_t trim;
+    // mean offset of the reference relative to this node at the last step, positive if the reference is faster
+    int32_t offset_ppb;
+} uwb_xtal_status_t;
+
+extern uwb_algorithm_t uwb_xtal_algorithm;
+
+/**
+ * @brief Prepare a calibration against a reference anchor. Run it with
+ * uwb_calibrate_xtal()
+ * @param reference: short address of the reference anchor
+ * @param frames: frames from the reference averaged per trim step
+ * @return 0 on success, negative if a calibration is already running or frames is 0
+ */
+int uwb_xtal_prepare(uint16_t reference, uint16_t frames);
+
+/**
+ * @brief Check whether the calibration algorithm still needs the radio
+ */
+bool uwb_xtal_running();
+
+void uwb_xtal_status(uwb_xtal_status_t *status);
+
+/**
+ * @brief Frequency offset of the transmitter of the last received frame
+ * relative to this node
+ * @param carrier_integrator: value of dwt_readcarrierintegrator()
+ * @param config: PHY configuration the frame was received with
+ * @return offset in ppb, positive if the transmitter is faster
+ */
+int32_t uwb_xtal_offset_ppb(int32_t carrier_integrator, const dwt_config_t *config);
+
+#endif // __UWB_XTAL_H__
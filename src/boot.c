@@ -0,0 +1,80 @@
+/**
+ * @file boot.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "boot.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+static const char *phase_names[] = {
+    [BOOT_PHASE_MAIN] = "main",
+    [BOOT_PHASE_FLASH_MOUNTED] = "flash mounted",
+    [BOOT_PHASE_CONFIG_VALID] = "config valid",
+    [BOOT_PHASE_RADIO_INITIALIZED] = "dw1000 initialized",
+    [BOOT_PHASE_RADIO_STARTED] = "radio started",
+    [BOOT_PHASE_FIRST_FRAME] = "first tx/rx",
+};
+
+_Static_assert(ARRAY_SIZE(phase_names) == BOOT_PHASE_MAX, "Missing boot phase name");
+
+static int64_t phase_ticks[BOOT_PHASE_MAX];
+static atomic_t reached;
+
+void boot_mark(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_MAX || atomic_test_bit(&reached, phase))
+    {
+        return;
+    }
+
+    phase_ticks[phase] = k_uptime_ticks();
+    atomic_set_bit(&reached, phase);
+}
+
+int64_t boot_phase_us(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_MAX || !atomic_test_bit(&reached, phase))
+    {
+        return -1;
+    }
+
+    return k_ticks_to_us_floor64(phase_ticks[phase]);
+}
+
+const char *boot_phase_name(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_MAX)
+    {
+        return "UNKNOWN";
+    }
+
+    return phase_names[phase];
+}
@@ -29,25 +29,218 @@
  *
  */
 
+#include "boot.h"
 #include "config.h"
+#include "port.h"
+#include "telemetry.h"
 #include "uwb.h"
+#include "uwb_airtime.h"
+#include "uwb_cir.h"
+#include "uwb_events.h"
+#include "uwb_phy.h"
+#include "uwb_protocol.h"
+#include "uwb_provision.h"
+#include "uwb_stats.h"
+#include "uwb_xtal.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/shell/shell.h>
 
+// Largest number of elements settable with 'config set'
+#define CONFIG_SIZE_ARRAY_MAX 8
+// Largest binary batch accepted by 'config batch'
+#define CONFIG_SIZE_BATCH_MAX 256
+// Interrupt capture timer ticks to ns, PORT_IRQ_CAPTURE_HZ is a whole number of MHz
+#define CAPTURE_TICKS_TO_NS(ticks) ((uint64_t)(ticks) * 1000 / (PORT_IRQ_CAPTURE_HZ / 1000000))
+
 static int cmd_config_dump(const struct shell *shell, size_t argc, char **argv)
 {
-    uint8_t buffer[CONFIG_SIZE_BUFFER];
-    config_buffer(buffer, CONFIG_SIZE_BUFFER);
-    shell_hexdump(shell, buffer, CONFIG_SIZE_BUFFER);
+    uint8_t buffer[64];
+    size_t offset = 0;
+    size_t read_size;
+    while ((read_size = config_buffer(buffer, offset, sizeof(buffer))) > 0)
+    {
+        shell_hexdump(shell, buffer, read_size);
+        offset += read_size;
+    }
 
     return 0;
 }
 
+static void print_field(const struct shell *shell, config_field_t field)
+{
+    const config_schema_t *schema = config_schema(field);
+    shell_fprintf(shell, SHELL_NORMAL, "%-20s", schema->name);
+    for (int i = 0; i < schema->count; ++i)
+    {
+        uint32_t value;
+        if (config_get_element(field, i, &value) != 0)
+        {
+            shell_fprintf(shell, SHELL_WARNING, " <unset>");
+            break;
+        }
+        shell_fprintf(shell, SHELL_NORMAL, schema->type == CONFIG_TYPE_U8 && schema->count > 1 ? " %02x" : " %u", value);
+    }
+    shell_fprintf(shell, SHELL_NORMAL, "\n");
+}
+
 static int cmd_config_print(const struct shell *shell, size_t argc, char **argv)
 {
-    shell_warn(shell, "NOT IMPLEMENTED");
+    for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+    {
+        print_field(shell, field);
+    }
+
+    return 0;
+}
+
+static int cmd_config_get(const struct shell *shell, size_t argc, char **argv)
+{
+    int field = config_field_by_name(argv[1]);
+    if (field < 0)
+    {
+        shell_error(shell, "Unknown field '%s'", argv[1]);
+        return -1;
+    }
+
+    print_field(shell, field);
+
+    return 0;
+}
+
+/**
+ * @brief Parse a field value given as separate arguments or as a single ':'
+ * separated argument
+ * @param argv: value arguments
+ * @return value size on success, negative on error
+ */
+static int parse_field_value(const struct shell *shell, config_field_t field, size_t argc, char **argv, uint8_t *value)
+{
+    const config_schema_t *schema = config_schema(field);
+    const size_t element_size = config_type_size(schema->type);
+    if (schema->count > CONFIG_SIZE_ARRAY_MAX)
+    {
+        shell_error(shell, "Field '%s' is too large to set from the shell", schema->name);
+        return -1;
+    }
+
+    char *rest = argv[0];
+    char *token;
+    int i = 0;
+    int arg = 0;
+    while (i < schema->count)
+    {
+        token = strtok_r(rest, ":;,", &rest);
+        if (token == NULL)
+        {
+            if (++arg >= argc)
+            {
+                break;
+            }
+            rest = argv[arg];
+            continue;
+        }
+
+        int err = 0;
+        unsigned long element = shell_strtoul(token, schema->type == CONFIG_TYPE_U8 && schema->count > 1 ? 16 : 0, &err);
+        if (err != 0 || element < schema->min || element > schema->max)
+        {
+            shell_error(shell, "Invalid value '%s', expected [%u, %u]", token, schema->min, schema->max);
+            return -2;
+        }
+
+        memcpy(&value[i * element_size], &element, element_size);
+        ++i;
+    }
+
+    if (i != schema->count)
+    {
+        shell_error(shell, "Invalid value count. Got '%u', expected '%u'", i, schema->count);
+        return -3;
+    }
+
+    return element_size * schema->count;
+}
+
+static int cmd_config_set(const struct shell *shell, size_t argc, char **argv)
+{
+    int field = config_field_by_name(argv[1]);
+    if (field < 0)
+    {
+        shell_error(shell, "Unknown field '%s'", argv[1]);
+        return -1;
+    }
+
+    uint8_t value[sizeof(uint32_t) * CONFIG_SIZE_ARRAY_MAX];
+    int size = parse_field_value(shell, field, argc - 2, &argv[2], value);
+    if (size < 0)
+    {
+        return -2;
+    }
+
+    if (config_set(field, value, size) != 0)
+    {
+        shell_error(shell, "Failed to set '%s'", config_schema(field)->name);
+        return -3;
+    }
+
+    print_field(shell, field);
+
+    return 0;
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Apply a binary batch of TLV records or a full configuration image
+ * given as hexadecimal arguments, and reply with a single status line that
+ * is easy to parse from a host script
+ */
+static int cmd_config_batch(const struct shell *shell, size_t argc, char **argv)
+{
+    static uint8_t batch[CONFIG_SIZE_BATCH_MAX];
+    size_t length = 0;
+    for (size_t arg = 1; arg < argc; ++arg)
+    {
+        for (const char *c = argv[arg]; c[0] != '\0'; c += 2)
+        {
+            int high = hex_nibble(c[0]);
+            int low = c[1] != '\0' ? hex_nibble(c[1]) : -1;
+            if (high < 0 || low < 0 || length >= sizeof(batch))
+            {
+                shell_print(shell, "error -5");
+                return -1;
+            }
+            batch[length++] = (high << 4) | low;
+        }
+    }
+
+    int ret = config_is_image(batch, length) ? config_apply_image(batch, length) : config_apply_tlv(batch, length);
+    if (ret != 0)
+    {
+        shell_print(shell, "error %d", ret);
+        return -2;
+    }
+
+    shell_print(shell, "ok %08x", config_crc());
 
     return 0;
 }
@@ -71,12 +264,14 @@ static int cmd_config_mode(const struct shell *shell, size_t argc, char **argv)
         if (strcmp(argv[1], "tag") == 0 || strcmp(argv[1], "0") == 0)
         {
             argv[1] = "tag";
-            ret = config_write_u8(CONFIG_FIELD_MODE, UWB_MODE_TAG);
+            uint8_t mode = UWB_MODE_TAG;
+            ret = config_set(CONFIG_FIELD_MODE, &mode, sizeof(mode));
         }
         else if (strcmp(argv[1], "anchor") == 0 || strcmp(argv[1], "1") == 0)
         {
             argv[1] = "anchor";
-            ret = config_write_u8(CONFIG_FIELD_MODE, UWB_MODE_ANCHOR);
+            uint8_t mode = UWB_MODE_ANCHOR;
+            ret = config_set(CONFIG_FIELD_MODE, &mode, sizeof(mode));
         }
         else
         {
@@ -96,7 +291,7 @@ static int cmd_config_mode(const struct shell *shell, size_t argc, char **argv)
     else
     {
         uint8_t mode;
-        ret = config_read_u8(CONFIG_FIELD_MODE, &mode);
+        ret = config_get(CONFIG_FIELD_MODE, &mode, sizeof(mode));
         if (ret != 0)
         {
             shell_error(shell, "Failed to retrieve current UWB mode");
@@ -148,30 +343,24 @@ static int cmd_config_address(const struct shell *shell, size_t argc, char **arg
             return -3;
         }
 
-        if (config_write_u8_array(CONFIG_FIELD_ADDRESS, 8, new_address) != 0)
+        if (config_set(CONFIG_FIELD_ADDRESS, new_address, sizeof(new_address)) != 0)
         {
             shell_error(shell, "Failed to write address to config");
             return -4;
         }
 
-        uint8_t address[8];
-        if (config_read_u8_array(CONFIG_FIELD_ADDRESS, 8, address) != 0)
-        {
-            shell_error(shell, "Failed to re-read address from config");
-        }
-
         shell_fprintf(shell, SHELL_VT100_COLOR_GREEN, "Set UWB address to ");
         i = 0;
         for (; i < 7; ++i)
         {
-            shell_fprintf(shell, SHELL_VT100_COLOR_GREEN, "%x:", address[i]);
+            shell_fprintf(shell, SHELL_VT100_COLOR_GREEN, "%x:", new_address[i]);
         }
-        shell_fprintf(shell, SHELL_VT100_COLOR_GREEN, "%x\n", address[i]);
+        shell_fprintf(shell, SHELL_VT100_COLOR_GREEN, "%x\n", new_address[i]);
     }
     else
     {
         uint8_t address[8];
-        if (config_read_u8_array(CONFIG_FIELD_ADDRESS, 8, address) != 0)
+        if (config_get(CONFIG_FIELD_ADDRESS, address, sizeof(address)) != 0)
         {
             shell_error(shell, "Failed to retrieve current address");
             return -4;
@@ -197,7 +386,7 @@ static int cmd_config_anchor_position(const struct shell *shell, size_t argc, ch
     }
     if (argc > 2)
     {
-        uint32_t new_x, new_y, old_x, old_y;
+        uint32_t new_x, new_y;
         int err = 0;
         new_x = shell_strtoul(argv[1], 10, &err);
         if (err != 0)
@@ -211,30 +400,23 @@ static int cmd_config_anchor_position(const struct shell *shell, size_t argc, ch
             shell_error(shell, "Invalid format for 'y' coordinate");
             return -3;
         }
-        if (config_write_u32(CONFIG_FIELD_ANCHOR_X_POS_MM, new_x) != 0)
+        config_begin();
+        if (config_set(CONFIG_FIELD_ANCHOR_X_POS_MM, &new_x, sizeof(new_x)) != 0)
         {
+            config_abort();
             shell_error(shell, "Failed to write 'x' coordinate");
             return -4;
         }
-        if (config_write_u32(CONFIG_FIELD_ANCHOR_Y_POS_MM, new_y) != 0)
+        if (config_set(CONFIG_FIELD_ANCHOR_Y_POS_MM, &new_y, sizeof(new_y)) != 0)
         {
+            config_abort();
             shell_error(shell, "Failed to write 'y' coordinate");
             return -5;
         }
-        if (config_read_u32(CONFIG_FIELD_ANCHOR_X_POS_MM, &old_x) != 0)
-        {
-            shell_error(shell, "Failed to re-read 'x' coordinate");
-            return -6;
-        }
-        if (config_read_u32(CONFIG_FIELD_ANCHOR_Y_POS_MM, &old_y) != 0)
-        {
-            shell_error(shell, "Failed to re-read 'y' coordinate");
-            return -7;
-        }
-        if (old_x != new_x || old_y != new_y)
+        if (config_commit() != 0)
         {
             shell_error(shell, "Failed to write coordinates");
-            return -8;
+            return -6;
         }
 
         shell_info(shell, "Set coordinates to x: %u, y: %u", new_x, new_y);
@@ -243,7 +425,7 @@ static int cmd_config_anchor_position(const struct shell *shell, size_t argc, ch
     else if (argc == 1)
     {
         uint32_t x, y;
-        if (config_read_u32(CONFIG_FIELD_ANCHOR_X_POS_MM, &x) != 0 || config_read_u32(CONFIG_FIELD_ANCHOR_Y_POS_MM, &y) != 0)
+        if (config_get(CONFIG_FIELD_ANCHOR_X_POS_MM, &x, sizeof(x)) != 0 || config_get(CONFIG_FIELD_ANCHOR_Y_POS_MM, &y, sizeof(y)) != 0)
         {
             shell_error(shell, "Failed to read anchor position");
             return -9;
@@ -253,9 +435,469 @@ static int cmd_config_anchor_position(const struct shell *shell, size_t argc, ch
     return 0;
 }
 
+static int cmd_uwb_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    shell_print(shell, "%-6s %8s %8s %6s %6s %8s %12s %10s",
+                "src", "rx", "missed", "ooo", "dup", "per(%)", "interval(us)", "jitter(us)");
+
+    for (int i = 0; i < UWB_STATS_MAX_SOURCES; ++i)
+    {
+        uwb_stats_source_t source;
+        if (uwb_stats_read(i, &source) != 0)
+        {
+            continue;
+        }
+
+        const uint32_t expected = source.received + source.missed;
+        const uint32_t per_permille = expected > 0 ? (uint64_t)source.missed * 1000 / expected : 0;
+        shell_print(shell, "%04x   %8u %8u %6u %6u %4u.%u %12u %10u",
+                    source.address,
+                    source.received,
+                    source.missed,
+                    source.out_of_order,
+                    source.duplicates,
+                    per_permille / 10,
+                    per_permille % 10,
+                    source.interval_us,
+                    source.jitter_us);
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_stats_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    uwb_stats_reset();
+    shell_info(shell, "Cleared link statistics");
+
+    return 0;
+}
+
+static int cmd_uwb_provision(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = 0;
+    unsigned long target = shell_strtoul(argv[1], 16, &err);
+    if (err != 0 || target > 0xFFFF)
+    {
+        shell_error(shell, "Invalid target address '%s'", argv[1]);
+        return -1;
+    }
+
+    int field = config_field_by_name(argv[2]);
+    if (field < 0)
+    {
+        shell_error(shell, "Unknown field '%s'", argv[2]);
+        return -2;
+    }
+
+    uint8_t value[sizeof(uint32_t) * CONFIG_SIZE_ARRAY_MAX];
+    int size = parse_field_value(shell, field, argc - 3, &argv[3], value);
+    if (size < 0)
+    {
+        return -3;
+    }
+
+    int sequence = uwb_provision_send(target, field, value, size);
+    if (sequence < 0)
+    {
+        shell_error(shell, "Failed to send config update");
+        return -4;
+    }
+
+    shell_info(shell, "Sending config update %d to '%04lx'", sequence, target);
+
+    return 0;
+}
+
+static void print_phy_profile(const struct shell *shell, uwb_phy_profile_t profile)
+{
+    const uwb_phy_profile_desc_t *desc = uwb_phy_profile(profile);
+    const uint32_t sync_ns = uwb_airtime_frame_ns(&desc->config, UWB_FRAME_OVERHEAD + sizeof(uwb_msg_sync_t));
+    shell_print(shell, "%c %-8s %5u.%u us  %s",
+                profile == uwb_phy_current() ? '*' : ' ',
+                desc->name,
+                sync_ns / 1000,
+                (sync_ns % 1000) / 100,
+                desc->description);
+}
+
+static int cmd_uwb_phy(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc > 1)
+    {
+        int profile = uwb_phy_profile_by_name(argv[1]);
+        if (profile < 0)
+        {
+            shell_error(shell, "Unknown PHY profile '%s'", argv[1]);
+            return -1;
+        }
+
+        uint8_t value = profile;
+        if (config_set(CONFIG_FIELD_PHY_PROFILE, &value, sizeof(value)) != 0)
+        {
+            shell_error(shell, "Failed to set PHY profile");
+            return -2;
+        }
+        shell_info(shell, "Set PHY profile to '%s'", argv[1]);
+        return 0;
+    }
+
+    shell_print(shell, "  %-8s %10s  %s", "profile", "sync", "description");
+    for (int profile = 0; profile < UWB_PHY_PROFILE_MAX; ++profile)
+    {
+        print_phy_profile(shell, profile);
+    }
+
+    return 0;
+}
+
+static void print_frame_airtime(const struct shell *shell, const dwt_config_t *phy, const char *name, size_t frame_length)
+{
+    uwb_airtime_t airtime;
+    uwb_airtime_frame(phy, frame_length, &airtime);
+    shell_print(shell, "%-12s %5zu %8u %6u %6u %8u %8u",
+                name,
+                frame_length,
+                airtime.preamble_ns,
+                airtime.sfd_ns,
+                airtime.phr_ns,
+                airtime.payload_ns,
+                airtime.total_ns);
+}
+
+static int cmd_uwb_airtime(const struct shell *shell, size_t argc, char **argv)
+{
+    int profile = uwb_phy_current();
+    if (argc > 1)
+    {
+        profile = uwb_phy_profile_by_name(argv[1]);
+        if (profile < 0)
+        {
+            shell_error(shell, "Unknown PHY profile '%s'", argv[1]);
+            return -1;
+        }
+    }
+
+    uint16_t sync_interval_ms;
+    uint8_t anchor_count;
+    if (config_get(CONFIG_FIELD_SYNC_INTERVAL_MS, &sync_interval_ms, sizeof(sync_interval_ms)) != 0 ||
+        config_get(CONFIG_FIELD_ANCHOR_COUNT, &anchor_count, sizeof(anchor_count)) != 0)
+    {
+        shell_error(shell, "Failed to read the sync schedule");
+        return -2;
+    }
+
+    const dwt_config_t *phy = &uwb_phy_profile(profile)->config;
+    shell_print(shell, "Profile '%s', durations in ns", uwb_phy_profile(profile)->name);
+    shell_print(shell, "%-12s %5s %8s %6s %6s %8s %8s", "frame", "bytes", "preamble", "sfd", "phr", "payload", "total");
+    print_frame_airtime(shell, phy, "sync", UWB_FRAME_OVERHEAD + sizeof(uwb_msg_sync_t));
+    print_frame_airtime(shell, phy, "anchor_info", UWB_FRAME_OVERHEAD + sizeof(uwb_msg_anchor_info_t) + sizeof(uwb_msg_config_ack_t));
+    print_frame_airtime(shell, phy, "blink", UWB_FRAME_OVERHEAD + sizeof(uwb_msg_blink_t) + sizeof(uwb_msg_config_ack_t));
+
+    const uint32_t slot_ns = uwb_airtime_slot_ns(phy);
+    const uint32_t min_interval_us = uwb_airtime_min_sync_interval_us(phy, anchor_count);
+    const uint32_t max_rate_mhz = 1000000000UL / min_interval_us;
+    const uint32_t load_permille = (uint64_t)anchor_count * slot_ns / ((uint32_t)sync_interval_ms * 1000);
+    shell_print(shell, "Slot: %u ns", slot_ns);
+    shell_print(shell, "Anchors: %u, minimum sync interval %u us, maximum sync rate %u.%03u Hz",
+                anchor_count,
+                min_interval_us,
+                max_rate_mhz / 1000,
+                max_rate_mhz % 1000);
+    shell_print(shell, "Sync interval: %u ms, channel load %u.%u%%", sync_interval_ms, load_permille / 10, load_permille % 10);
+    if (uwb_airtime_check(phy, anchor_count, sync_interval_ms) != 0)
+    {
+        shell_warn(shell, "Channel is oversubscribed");
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_delays(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const names[PORT_DELAY_MAX] = {"busy", "sleep"};
+
+    shell_print(shell, "%-6s %8s %12s %12s %10s", "kind", "count", "requested", "actual", "max over");
+    for (int kind = 0; kind < PORT_DELAY_MAX; ++kind)
+    {
+        port_delay_stats_t stats;
+        if (port_delay_stats(kind, &stats) != 0)
+        {
+            shell_error(shell, "Delays are not measured, enable CONFIG_TDOA_DRIVER_STATS");
+            return -1;
+        }
+        shell_print(shell, "%-6s %8u %10llu us %10llu us %7u us",
+                    names[kind],
+                    stats.count,
+                    stats.requested_us,
+                    stats.actual_us,
+                    stats.max_overshoot_us);
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_delays_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    port_delay_stats_reset();
+    shell_info(shell, "Cleared delay statistics");
+
+    return 0;
+}
+
+static int cmd_uwb_locks(const struct shell *shell, size_t argc, char **argv)
+{
+    port_lock_stats_t stats;
+    if (port_lock_stats(&stats) != 0)
+    {
+        shell_error(shell, "Locking is not measured, enable CONFIG_TDOA_DRIVER_STATS");
+        return -1;
+    }
+
+    // every SPI transaction opens and closes one critical section
+    const uint32_t transactions = stats.count / 2;
+    shell_print(shell, "SPI transactions: %u", transactions);
+    if (transactions > 0)
+    {
+        shell_print(shell, "Lock overhead: %llu ns per transaction, %u ns worst single operation",
+                    stats.total_ns / transactions,
+                    stats.max_ns);
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_locks_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    port_lock_stats_reset();
+    shell_info(shell, "Cleared lock statistics");
+
+    return 0;
+}
+
+static int cmd_uwb_irq(const struct shell *shell, size_t argc, char **argv)
+{
+    port_irq_capture_stats_t stats;
+    if (port_irq_capture_stats(&stats) != 0)
+    {
+        shell_error(shell, "DW1000 interrupts are not captured");
+        return -1;
+    }
+
+    shell_print(shell, "Interrupts: %u", stats.count);
+    if (stats.count > 0)
+    {
+        shell_print(shell, "Edge to GPIO callback: %llu ns mean, %llu ns max",
+                    CAPTURE_TICKS_TO_NS(stats.isr_total_ticks) / stats.count,
+                    CAPTURE_TICKS_TO_NS(stats.isr_max_ticks));
+        shell_print(shell, "Edge to radio thread: %llu ns mean, %llu ns max",
+                    CAPTURE_TICKS_TO_NS(stats.thread_total_ticks) / stats.count,
+                    CAPTURE_TICKS_TO_NS(stats.thread_max_ticks));
+    }
+    if (stats.rx_count > 0)
+    {
+        shell_print(shell, "Edge to RX re-enable: %llu ns mean, %llu ns max (%u)",
+                    CAPTURE_TICKS_TO_NS(stats.rx_total_ticks) / stats.rx_count,
+                    CAPTURE_TICKS_TO_NS(stats.rx_max_ticks),
+                    stats.rx_count);
+    }
+
+    uint64_t device_time;
+    uint32_t mcu_ticks;
+    if (uwb_time_correlation(&device_time, &mcu_ticks) == 0)
+    {
+        shell_print(shell, "Last frame end: device %llu, timer %u", device_time, mcu_ticks);
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_irq_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    port_irq_capture_stats_reset();
+    shell_info(shell, "Cleared interrupt statistics");
+
+    return 0;
+}
+
+static int cmd_uwb_cir(const struct shell *shell, size_t argc, char **argv)
+{
+    uwb_cir_status_t status;
+    uwb_cir_status(&status);
+
+    if (!status.enabled)
+    {
+        shell_print(shell, "Capture: off");
+    }
+    else if (status.source == UWB_CIR_SOURCE_ANY)
+    {
+        shell_print(shell, "Capture: %u taps of 1 in %u frames from any source", status.taps, status.every);
+    }
+    else
+    {
+        shell_print(shell, "Capture: %u taps of 1 in %u frames from %04x", status.taps, status.every, status.source);
+    }
+    shell_print(shell, "Captured: %u, dropped: %u, overwritten: %u", status.captured, status.dropped, status.overwritten);
+
+    telemetry_stats_t stats;
+    telemetry_stats(&stats);
+    shell_print(shell, "Telemetry: %u records, %u dropped, %u bytes streamed", stats.records, stats.dropped, stats.streamed_bytes);
+
+    return 0;
+}
+
+static int cmd_uwb_cir_start(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = 0;
+    unsigned long source = argc > 1 ? shell_strtoul(argv[1], 16, &err) : UWB_CIR_SOURCE_ANY;
+    if (err != 0 || source > 0xFFFF)
+    {
+        shell_error(shell, "Invalid source address '%s'", argv[1]);
+        return -1;
+    }
+
+    unsigned long taps = argc > 2 ? shell_strtoul(argv[2], 10, &err) : 16;
+    unsigned long every = argc > 3 ? shell_strtoul(argv[3], 10, &err) : 1;
+    if (err != 0 || taps > UINT16_MAX || every > UINT16_MAX || uwb_cir_start(source, taps, every) != 0)
+    {
+        shell_error(shell, "Invalid window length or rate");
+        return -2;
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_cir_stop(const struct shell *shell, size_t argc, char **argv)
+{
+    uwb_cir_stop();
+
+    return 0;
+}
+
+static int cmd_uwb_xtal(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const states[] = {"idle", "running", "done", "failed"};
+
+    uwb_xtal_status_t status;
+    uwb_xtal_status(&status);
+
+    port_dw1000_lock();
+    const uint8_t trim = dwt_getxtaltrim();
+    port_dw1000_unlock();
+
+    shell_print(shell, "Trim: %u", trim);
+    shell_print(shell, "Calibration: %s", states[status.state]);
+    if (status.state == UWB_XTAL_IDLE)
+    {
+        return 0;
+    }
+    shell_print(shell, "Reference: %04x, %u frames per step, step %u of %u", status.reference, status.frames, status.iteration, UWB_XTAL_ITERATIONS_MAX);
+    shell_print(shell, "Initial: trim %u, offset %d ppb", status.initial_trim, status.initial_offset_ppb);
+    shell_print(shell, "Current: trim %u, offset %d ppb", status.trim, status.offset_ppb);
+
+    return 0;
+}
+
+static int cmd_uwb_xtal_calibrate(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = 0;
+    unsigned long reference = shell_strtoul(argv[1], 16, &err);
+    if (err != 0 || reference > 0xFFFF)
+    {
+        shell_error(shell, "Invalid reference address '%s'", argv[1]);
+        return -1;
+    }
+
+    unsigned long frames = argc > 2 ? shell_strtoul(argv[2], 10, &err) : 20;
+    if (err != 0 || frames == 0 || frames > UINT16_MAX)
+    {
+        shell_error(shell, "Invalid frame count '%s'", argv[2]);
+        return -2;
+    }
+
+    int ret = uwb_calibrate_xtal(reference, frames);
+    if (ret == -2)
+    {
+        shell_error(shell, "Radio is not running");
+        return -3;
+    }
+    if (ret != 0)
+    {
+        shell_error(shell, "Calibration already running");
+        return -4;
+    }
+
+    shell_info(shell, "Calibrating against '%04lx', see 'uwb xtal'", reference);
+
+    return 0;
+}
+
+static int cmd_uwb_events(const struct shell *shell, size_t argc, char **argv)
+{
+    uwb_events_t events;
+    if (uwb_events_read(&events) != 0)
+    {
+        shell_error(shell, "Event counters not sampled yet");
+        return -1;
+    }
+
+    shell_print(shell, "%-18s %10s %8s %10s", "event", "total", "last", "rate (/s)");
+    for (int i = 0; i < UWB_EVC_MAX; ++i)
+    {
+        shell_print(shell, "%-18s %10u %8u %7u.%02u",
+                    uwb_events_name(i),
+                    events.total[i],
+                    events.last[i],
+                    events.rate_x100[i] / 100,
+                    events.rate_x100[i] % 100);
+    }
+    shell_print(shell, "Last period: %u ms", events.period_ms);
+
+    const uint32_t errors = events.total[UWB_EVC_PHR_ERROR] + events.total[UWB_EVC_RS_SYNC_LOSS] + events.total[UWB_EVC_FCS_ERROR];
+    const uint32_t frames = errors + events.total[UWB_EVC_FCS_GOOD];
+    if (frames > 0)
+    {
+        const uint32_t ratio_x100 = (uint64_t)errors * 10000 / frames;
+        shell_print(shell, "Frame error ratio: %u.%02u %%", ratio_x100 / 100, ratio_x100 % 100);
+    }
+
+    return 0;
+}
+
+static int cmd_uwb_events_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    uwb_events_reset();
+    shell_info(shell, "Cleared event counters");
+
+    return 0;
+}
+
+static int cmd_boot(const struct shell *shell, size_t argc, char **argv)
+{
+    int64_t previous_us = 0;
+    shell_print(shell, "%-20s %12s %12s", "phase", "time(us)", "delta(us)");
+    shell_print(shell, "%-20s %12u %12u", "power on", 0, 0);
+    for (int phase = 0; phase < BOOT_PHASE_MAX; ++phase)
+    {
+        int64_t phase_us = boot_phase_us(phase);
+        if (phase_us < 0)
+        {
+            shell_print(shell, "%-20s %12s %12s", boot_phase_name(phase), "-", "-");
+            continue;
+        }
+        shell_print(shell, "%-20s %12lld %12lld", boot_phase_name(phase), phase_us, phase_us - previous_us);
+        previous_us = phase_us;
+    }
+
+    return 0;
+}
+
 SHELL_STATIC_SUBCMD_SET_CREATE(config_sub,
-                               SHELL_CMD(dump, NULL, "Dump configuration in hexadecimal format", cmd_config_dump),
+                               SHELL_COND_CMD(CONFIG_TDOA_SHELL_DIAGNOSTICS, dump, NULL, "Dump configuration in hexadecimal format", cmd_config_dump),
                                SHELL_CMD(print, NULL, "Print configuration in human-readable format", cmd_config_print),
+                               SHELL_CMD_ARG(get, NULL, "Get a configuration field by name", cmd_config_get, 2, 0),
+                               SHELL_CMD_ARG(set, NULL, "Set a configuration field by name", cmd_config_set, 3, CONFIG_SIZE_ARRAY_MAX - 1),
+                               SHELL_CMD_ARG(batch, NULL, "Apply hex encoded TLV records or a configuration image", cmd_config_batch, 2, 8),
                                SHELL_CMD(erase, NULL, "Erase configuration from flash", cmd_config_erase),
                                SHELL_CMD_ARG(mode, NULL, "Set/Get UWB mode", cmd_config_mode, 1, 1),
                                SHELL_CMD_ARG(address, NULL, "Set/Get UWB address", cmd_config_address, 1, 1),
@@ -263,3 +905,49 @@ SHELL_STATIC_SUBCMD_SET_CREATE(config_sub,
                                SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(config, &config_sub, "Configuration commands", NULL);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_stats_sub,
+                               SHELL_CMD(reset, NULL, "Clear link statistics", cmd_uwb_stats_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_delays_sub,
+                               SHELL_CMD(reset, NULL, "Clear delay statistics", cmd_uwb_delays_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_locks_sub,
+                               SHELL_CMD(reset, NULL, "Clear lock statistics", cmd_uwb_locks_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_irq_sub,
+                               SHELL_CMD(reset, NULL, "Clear interrupt statistics", cmd_uwb_irq_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_events_sub,
+                               SHELL_CMD(reset, NULL, "Clear event counter totals", cmd_uwb_events_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_cir_sub,
+                               SHELL_CMD_ARG(start, NULL, "Capture CIR windows: [source] [taps] [every]", cmd_uwb_cir_start, 1, 3),
+                               SHELL_CMD(stop, NULL, "Stop capturing", cmd_uwb_cir_stop),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_xtal_sub,
+                               SHELL_CMD_ARG(calibrate, NULL, "Calibrate against a reference anchor: <reference> [frames]", cmd_uwb_xtal_calibrate, 2, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uwb_sub,
+                               SHELL_COND_CMD(CONFIG_TDOA_STATS, stats, &uwb_stats_sub, "Print per-source link statistics", cmd_uwb_stats),
+                               SHELL_COND_CMD(CONFIG_TDOA_DRIVER_STATS, delays, &uwb_delays_sub, "Print requested versus measured driver delays", cmd_uwb_delays),
+                               SHELL_COND_CMD(CONFIG_TDOA_DRIVER_STATS, locks, &uwb_locks_sub, "Print DW1000 locking overhead", cmd_uwb_locks),
+                               SHELL_COND_CMD(CONFIG_TDOA_IRQ_CAPTURE, irq, &uwb_irq_sub, "Print DW1000 interrupt latency", cmd_uwb_irq),
+                               SHELL_COND_CMD(CONFIG_TDOA_EVENT_COUNTERS, events, &uwb_events_sub, "Print DW1000 event counters and rates", cmd_uwb_events),
+                               SHELL_COND_CMD(CONFIG_TDOA_CIR_CAPTURE, cir, &uwb_cir_sub, "Print channel impulse response capture state", cmd_uwb_cir),
+                               SHELL_COND_CMD_ARG(CONFIG_TDOA_SHELL_DIAGNOSTICS, airtime, NULL, "Print frame airtime and channel capacity", cmd_uwb_airtime, 1, 1),
+                               SHELL_CMD_ARG(phy, NULL, "List PHY profiles or select one", cmd_uwb_phy, 1, 1),
+                               SHELL_CMD(xtal, &uwb_xtal_sub, "Print crystal trim and calibration state", cmd_uwb_xtal),
+                               SHELL_CMD_ARG(provision, NULL, "Send a config update over UWB", cmd_uwb_provision, 4, CONFIG_SIZE_ARRAY_MAX - 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(uwb, &uwb_sub, "UWB commands", NULL);
+
+SHELL_COND_CMD_REGISTER(CONFIG_TDOA_SHELL_DIAGNOSTICS, boot, NULL, "Print boot phase timeline", cmd_boot);
@@ -31,8 +31,12 @@
 
 #include "config.h"
 
+#include "boot.h"
+
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/flash.h>
 #include <zephyr/fs/nvs.h>
@@ -40,13 +44,18 @@
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/sys/crc.h>
 
-LOG_MODULE_REGISTER(config, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(config, CONFIG_TDOA_CONFIG_LOG_LEVEL);
 
 #define NVS_PARTITION storage_partition
 #define NVS_PARTITION_DEVICE FIXED_PARTITION_DEVICE(NVS_PARTITION)
 #define NVS_PARTITION_OFFSET FIXED_PARTITION_OFFSET(NVS_PARTITION)
 
+// Image written as the record of a commit in progress, or a legacy single-record
+// image. Either way its fields are moved to per-field entries at boot
 #define CONFIG_NVS_ID 0
+// Each field is stored as its own entry holding only its value
+#define CONFIG_NVS_ID_FIELD_BASE 0x100
+#define FIELD_NVS_ID(field) (CONFIG_NVS_ID_FIELD_BASE + (field))
 #define MAGIC 0xBEEF
 #define VERSION_MAJOR 1
 #define VERSION_MINOR 0
@@ -55,13 +64,12 @@ LOG_MODULE_REGISTER(config, LOG_LEVEL_DBG);
 #define SIZE_HEADER 6
 #define SIZE_TAIL 4
 #define SIZE_TLV_MAX (SIZE_READ - SIZE_HEADER - SIZE_TAIL)
+#define SIZE_USED (SIZE_HEADER + header->tlv_length + SIZE_TAIL)
 
 #define OFFSET_MAGIC 0
 #define OFFSET_MAJOR_VERSION 2
 #define OFFSET_MINOR_VERSION 3
 
-#define CONFIG_READ_DELAY 300
-
 typedef struct __packed
 {
     uint16_t magic;
@@ -76,23 +84,89 @@ typedef struct
 } tlv_t;
 
 static uint8_t _buffer[SIZE_READ];
+static uint8_t _committed[SIZE_READ];
 static config_header_t *header = (config_header_t *)_buffer;
 static tlv_t tlv;
 
+// Offset of each field in the TLV area, -1 if the field is not stored
+static int16_t field_index[CONFIG_FIELD_ID_MAX];
+
+#define CONFIG_SCHEMA_ENTRY(field, field_name, field_type, field_count, field_default, field_min, field_max) \
+    [CONFIG_FIELD_##field] = {                                                                               \
+        .name = field_name,                                                                                  \
+        .type = field_type,                                                                                  \
+        .count = field_count,                                                                                \
+        .default_value = field_default,                                                                      \
+        .min = field_min,                                                                                    \
+        .max = field_max,                                                                                    \
+    },
+
+static const config_schema_t schema[CONFIG_FIELD_MAX] = {CONFIG_SCHEMA(CONFIG_SCHEMA_ENTRY)};
+
+static const uint8_t type_sizes[CONFIG_TYPE_MAX] = {
+    [CONFIG_TYPE_U8] = sizeof(uint8_t),
+    [CONFIG_TYPE_U16] = sizeof(uint16_t),
+    [CONFIG_TYPE_U32] = sizeof(uint32_t),
+};
+
+// Largest value described by the schema
+#define SIZE_VALUE_MAX 32
+
+#define CONFIG_SCHEMA_CHECK(field, field_name, field_type, field_count, field_default, field_min, field_max) \
+    _Static_assert((field_count) * sizeof(uint32_t) <= SIZE_VALUE_MAX, "Config field " #field " is too large");
+
+CONFIG_SCHEMA(CONFIG_SCHEMA_CHECK)
+
+K_MUTEX_DEFINE(config_mutex);
+static struct
+{
+    int depth;
+    bool dirty;
+    bool aborted;
+    config_fields_t dirty_fields;
+} transaction;
+
+#define CONFIG_OBSERVERS_MAX 4
+
+static struct
+{
+    config_fields_t fields;
+    config_observer_t callback;
+} observers[CONFIG_OBSERVERS_MAX];
+
+#define CONFIG_VALIDATORS_MAX 4
+
+static struct
+{
+    config_fields_t fields;
+    config_validator_t callback;
+} validators[CONFIG_VALIDATORS_MAX];
+
 static struct nvs_fs fs;
+// Committed fields whose entries may still lag the commit record in flash
+static config_fields_t pending_fields;
 
 static int flash_init();
 static int read_buffer();
 static int check_data();
 static int check_magic();
-static int write_defaults();
+static void reset_image();
+static int load_image();
+static int complete_commit();
 static int check_crc();
 static void write_crc();
+static int build_index();
+static void restore_committed();
 static int find_field(config_field_t field);
 static int read_value(config_field_t field, uint8_t size, void *value);
-static int write_value(config_field_t field, uint8_t size, void *value);
-static int insert_value(int field_pos, config_field_t field, uint8_t size, void *value);
-static int append_value(config_field_t field, uint8_t size, void *value);
+static int write_value(config_field_t field, uint8_t size, const void *value);
+static int insert_value(int field_pos, config_field_t field, uint8_t size, const void *value);
+static int append_value(config_field_t field, uint8_t size, const void *value);
+static uint32_t decode_element(config_type_t type, const uint8_t *data);
+static void encode_element(config_type_t type, uint32_t value, uint8_t *data);
+static int write_fields();
+static void notify_observers(const config_fields_t *fields);
+static int run_validators(const config_fields_t *fields);
 
 int config_init()
 {
@@ -105,30 +179,179 @@ int config_init()
         return -1;
     }
 
-    k_msleep(CONFIG_READ_DELAY);
-    ret = read_buffer();
-    if (ret != 0)
+    boot_mark(BOOT_PHASE_FLASH_MOUNTED);
+
+    tlv.data = &_buffer[SIZE_HEADER];
+
+    ret = complete_commit();
+    if (ret < 0)
     {
-        LOG_ERR("Failed to read flash data: %d", ret);
+        LOG_ERR("Failed to complete interrupted commit: %d", ret);
         return -2;
     }
+    else if (ret > 0)
+    {
+        LOG_INF("Completed interrupted commit of %d fields", ret);
+    }
 
-    tlv.data = &_buffer[SIZE_HEADER];
+    ret = load_image();
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to load configuration: %d", ret);
+        return -3;
+    }
+    LOG_INF("Loaded %d stored fields, %d defaults", ret, CONFIG_FIELD_MAX - ret);
+    memcpy(_committed, _buffer, SIZE_READ);
+    boot_mark(BOOT_PHASE_CONFIG_VALID);
 
-    ret = check_data();
-    if (ret == 0)
+    return 0;
+}
+
+int config_begin()
+{
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    ++transaction.depth;
+
+    return 0;
+}
+
+int config_commit()
+{
+    if (transaction.depth == 0)
     {
-        LOG_INF("Configuration read and verified");
+        LOG_ERR("Commit without transaction");
+        return -1;
     }
-    else
+
+    int ret = 0;
+    config_fields_t changed = {0};
+    if (--transaction.depth == 0)
+    {
+        if (transaction.aborted)
+        {
+            LOG_WRN("Nested transaction was aborted, discarding changes");
+            restore_committed();
+            ret = -3;
+        }
+        else if (transaction.dirty && run_validators(&transaction.dirty_fields) != 0)
+        {
+            restore_committed();
+            ret = -4;
+        }
+        else if (transaction.dirty)
+        {
+            ret = write_fields();
+            if (ret != 0)
+            {
+                // Nothing was written, or the commit record failed before any field entry
+                LOG_ERR("Failed to commit config: %d", ret);
+                restore_committed();
+                ret = -2;
+            }
+            else
+            {
+                changed = transaction.dirty_fields;
+                memcpy(_committed, _buffer, SIZE_READ);
+            }
+        }
+        transaction.dirty = false;
+        transaction.aborted = false;
+        transaction.dirty_fields = (config_fields_t){0};
+    }
+
+    k_mutex_unlock(&config_mutex);
+
+    notify_observers(&changed);
+
+    return ret;
+}
+
+void config_abort()
+{
+    if (transaction.depth == 0)
+    {
+        return;
+    }
+
+    restore_committed();
+    transaction.dirty = false;
+    transaction.dirty_fields = (config_fields_t){0};
+    transaction.aborted = --transaction.depth > 0;
+
+    k_mutex_unlock(&config_mutex);
+}
+
+int config_observe(config_fields_t fields, config_observer_t callback)
+{
+    int ret = -1;
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    for (int i = 0; i < CONFIG_OBSERVERS_MAX; ++i)
+    {
+        if (observers[i].callback == NULL)
+        {
+            observers[i].fields = fields;
+            observers[i].callback = callback;
+            ret = 0;
+            break;
+        }
+    }
+    k_mutex_unlock(&config_mutex);
+
+    if (ret != 0)
+    {
+        LOG_ERR("No free config observer slot");
+    }
+
+    return ret;
+}
+
+int config_validate(config_fields_t fields, config_validator_t validator)
+{
+    int ret = -1;
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    for (int i = 0; i < CONFIG_VALIDATORS_MAX; ++i)
     {
-        ret = write_defaults();
-        if (ret != 0)
+        if (validators[i].callback == NULL)
         {
-            LOG_ERR("Failed to write default config to flash: %d", ret);
-            return -3;
+            validators[i].fields = fields;
+            validators[i].callback = validator;
+            ret = 0;
+            break;
+        }
+    }
+    k_mutex_unlock(&config_mutex);
+
+    if (ret != 0)
+    {
+        LOG_ERR("No free config validator slot");
+    }
+
+    return ret;
+}
+
+static void notify_observers(const config_fields_t *fields)
+{
+    config_fields_t observed;
+    for (int i = 0; i < CONFIG_OBSERVERS_MAX; ++i)
+    {
+        if (observers[i].callback != NULL && config_fields_intersect(&observers[i].fields, fields, &observed))
+        {
+            observers[i].callback(&observed);
+        }
+    }
+}
+
+static int run_validators(const config_fields_t *fields)
+{
+    config_fields_t validated;
+    for (int i = 0; i < CONFIG_VALIDATORS_MAX; ++i)
+    {
+        if (validators[i].callback != NULL && config_fields_intersect(&validators[i].fields, fields, &validated) &&
+            validators[i].callback(&validated) != 0)
+        {
+            LOG_WRN("Config changes rejected by validator");
+            return -1;
         }
-        LOG_INF("Wrote default config to flash");
     }
 
     return 0;
@@ -141,6 +364,14 @@ int config_erase()
         return -1;
     }
 
+    for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+    {
+        if (nvs_delete(&fs, FIELD_NVS_ID(field)) != 0)
+        {
+            return -2;
+        }
+    }
+
     return 0;
 }
 
@@ -167,23 +398,14 @@ static int flash_init()
         return -3;
     }
 
-    int dummy_buffer[1];
-    k_msleep(CONFIG_READ_DELAY);
-    if (nvs_read(&fs, CONFIG_NVS_ID, &dummy_buffer, sizeof(dummy_buffer)) < 0)
-    {
-        if (nvs_write(&fs, CONFIG_NVS_ID, &dummy_buffer, sizeof(dummy_buffer)) < 0)
-        {
-            LOG_ERR("Failed to write null config");
-            return -4;
-        }
-    }
-
     return 0;
 }
 
 static int read_buffer()
 {
     int ret;
+    // Records are stored at their used length, clear stale data past it
+    memset(_buffer, 0, SIZE_READ);
     ret = nvs_read(&fs, CONFIG_NVS_ID, &_buffer, SIZE_READ);
     if (ret < 0)
     {
@@ -201,7 +423,7 @@ static int check_data()
         return -1;
     }
 
-    if (header->tlv_length >= (SIZE_READ - SIZE_HEADER))
+    if (header->tlv_length > (SIZE_TLV_MAX))
     {
         LOG_ERR("Data length mismatch");
         return -2;
@@ -222,33 +444,109 @@ static int check_magic()
     return 0;
 }
 
-static int write_defaults()
+static void reset_image()
 {
+    memset(_buffer, 0, SIZE_READ);
+
     const uint16_t magic = (MAGIC);
     memcpy(&_buffer[OFFSET_MAGIC], &magic, sizeof(uint16_t));
 
     _buffer[OFFSET_MAJOR_VERSION] = VERSION_MAJOR;
     _buffer[OFFSET_MINOR_VERSION] = VERSION_MINOR;
 
+    build_index();
+}
+
+/**
+ * @brief Rebuild the RAM image from the per-field entries. Fields that are
+ * not stored, or whose size no longer matches the schema, use their default
+ * @return number of fields read from flash, negative on error
+ */
+static int load_image()
+{
+    reset_image();
+
+    int count = 0;
+    for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+    {
+        const uint8_t size = config_schema_size(field);
+        uint8_t value[SIZE_VALUE_MAX];
+        int ret = nvs_read(&fs, FIELD_NVS_ID(field), value, sizeof(value));
+        if (ret == size)
+        {
+            ++count;
+        }
+        else
+        {
+            if (ret >= 0)
+            {
+                LOG_WRN("Stored '%s' has size %d, expected %u", schema[field].name, ret, size);
+            }
+            else if (ret != -ENOENT)
+            {
+                return ret;
+            }
+            config_default(field, value, size);
+        }
+
+        if (append_value(field, size, value) < 0)
+        {
+            return -1;
+        }
+    }
     write_crc();
 
-    if (nvs_write(&fs, CONFIG_NVS_ID, &_buffer, SIZE_READ) < 0)
+    return count;
+}
+
+/**
+ * @brief Move the fields of a commit record left by a power loss or a failed
+ * field write, or of a legacy single-record image, into their own entries and
+ * delete the record. Replaying a commit that already completed is harmless
+ * @return number of fields moved, negative on error
+ */
+static int complete_commit()
+{
+    int ret = read_buffer();
+    if (ret == -ENOENT)
     {
-        return -1;
+        return 0;
+    }
+    else if (ret != 0)
+    {
+        return ret;
     }
 
-    k_msleep(CONFIG_READ_DELAY);
-    if (read_buffer() != 0)
+    int count = 0;
+    if (check_data() != 0 || build_index() != 0)
     {
-        return -2;
+        LOG_WRN("Discarding invalid commit record");
+    }
+    else
+    {
+        for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+        {
+            int pos = find_field(field);
+            if (pos < 0 || tlv.data[pos + 1] != config_schema_size(field))
+            {
+                continue;
+            }
+
+            if (nvs_write(&fs, FIELD_NVS_ID(field), &tlv.data[pos + 2], tlv.data[pos + 1]) < 0)
+            {
+                return -1;
+            }
+            ++count;
+        }
     }
 
-    if (check_data() != 0)
+    if (nvs_delete(&fs, CONFIG_NVS_ID) != 0)
     {
-        return -3;
+        return -2;
     }
+    pending_fields = (config_fields_t){0};
 
-    return 0;
+    return count;
 }
 
 static int check_crc()
@@ -273,84 +571,130 @@ static void write_crc()
     memcpy(&_buffer[SIZE_HEADER + header->tlv_length], &checksum, sizeof(uint32_t));
 }
 
-static int find_field(config_field_t field)
+static int build_index()
 {
+    for (int i = 0; i < CONFIG_FIELD_ID_MAX; ++i)
+    {
+        field_index[i] = -1;
+    }
+
     int pos = 0;
     while (pos < header->tlv_length)
     {
-        if (tlv.data[pos] == field)
+        if (pos + 2 + tlv.data[pos + 1] > header->tlv_length)
         {
-            return pos;
+            LOG_ERR("TLV entry at %d overruns data", pos);
+            return -1;
         }
-
+        field_index[tlv.data[pos]] = pos;
         pos += tlv.data[pos + 1] + 2;
     }
 
-    return -1;
+    return 0;
+}
+
+static void restore_committed()
+{
+    memcpy(_buffer, _committed, SIZE_READ);
+    build_index();
+}
+
+static int find_field(config_field_t field)
+{
+    if (field >= CONFIG_FIELD_ID_MAX)
+    {
+        return -1;
+    }
+
+    return field_index[field];
 }
 
 int config_refresh()
 {
-    k_msleep(CONFIG_READ_DELAY);
-    if (read_buffer() != 0)
+    int ret = 0;
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    if (complete_commit() < 0 || load_image() < 0)
     {
         LOG_ERR("Failed to refresh config");
-        return -1;
+        restore_committed();
+        ret = -1;
+    }
+    else
+    {
+        memcpy(_committed, _buffer, SIZE_READ);
     }
+    k_mutex_unlock(&config_mutex);
 
-    return 0;
+    if (ret == 0)
+    {
+        const config_fields_t all = config_fields_all();
+        notify_observers(&all);
+    }
+
+    return ret;
 }
 
-void config_buffer(uint8_t *buffer, size_t size)
+size_t config_buffer(uint8_t *buffer, size_t offset, size_t size)
 {
-    size_t read_size = MIN(size, SIZE_READ);
-    memcpy(buffer, &_buffer, read_size);
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    const size_t used = MIN(SIZE_USED, SIZE_READ);
+    size_t read_size = offset < used ? MIN(size, used - offset) : 0;
+    memcpy(buffer, &_buffer[offset], read_size);
+    k_mutex_unlock(&config_mutex);
+
+    return read_size;
 }
 
 int config_field_size(config_field_t field, uint8_t *size)
 {
+    k_mutex_lock(&config_mutex, K_FOREVER);
     int pos = find_field(field);
-    if (pos < 0)
+    if (pos >= 0)
     {
-        return -1;
+        *size = tlv.data[pos + 1];
     }
+    k_mutex_unlock(&config_mutex);
 
-    *size = tlv.data[pos + 1];
-
-    return 0;
+    return pos < 0 ? -1 : 0;
 }
 
 int read_value(config_field_t field, uint8_t size, void *value)
 {
+    int ret = 0;
+    k_mutex_lock(&config_mutex, K_FOREVER);
+
     int pos = find_field(field);
     if (pos < 0)
     {
-        return -1;
+        ret = -1;
     }
-    if (pos + 2 + size >= (SIZE_TLV_MAX))
+    else if (pos + 2 + size > (SIZE_TLV_MAX))
     {
         LOG_ERR("Field size exceeds maximum TLV length");
-        return -2;
+        ret = -2;
     }
-    if (size != tlv.data[pos + 1])
+    else if (size != tlv.data[pos + 1])
     {
         LOG_ERR("Field size mismatch when reading");
-        return -3;
+        ret = -3;
+    }
+    else
+    {
+        memcpy(value, &tlv.data[pos + 2], size);
     }
-    memcpy(value, &tlv.data[pos + 2], size);
 
-    return 0;
+    k_mutex_unlock(&config_mutex);
+
+    return ret;
 }
 
-int write_value(config_field_t field, uint8_t size, void *value)
+/**
+ * @brief Update a field in the RAM buffer. Outside of a transaction the
+ * change is committed to flash immediately
+ */
+int write_value(config_field_t field, uint8_t size, const void *value)
 {
-    const int bytes_to_insert = 2 + size;
-    const int bytes_avaliable = SIZE_TLV_MAX - header->tlv_length;
-    if (bytes_to_insert > bytes_avaliable)
-    {
-        LOG_ERR("Cannot add value to flash, not enough space");
-        return -1;
-    }
+    config_begin();
 
     int bytes_inserted = 0;
     int pos = find_field(field);
@@ -366,30 +710,88 @@ int write_value(config_field_t field, uint8_t size, void *value)
     if (bytes_inserted < 0)
     {
         LOG_ERR("Failed to insert value into buffer");
+        config_abort();
         return -2;
     }
+    transaction.dirty = true;
+    config_fields_add(&transaction.dirty_fields, field);
 
-    write_crc();
-    ssize_t bytes_written = nvs_write(&fs, CONFIG_NVS_ID, &_buffer, SIZE_READ);
-    if (bytes_written < 0)
+    if (config_commit() != 0)
     {
         LOG_ERR("Failed to write value to flash");
         return -3;
     }
 
-    k_msleep(CONFIG_READ_DELAY);
-    if (read_buffer() != 0)
+    return 0;
+}
+
+/**
+ * @brief Make the fields changed in this transaction durable. NVS writes each
+ * entry atomically, so a single changed field is written to its entry alone.
+ * For several fields the image is first written as the commit record, then
+ * the entry of every changed field, then the record is deleted: after a power
+ * loss either no record exists and no entry changed, or the complete record
+ * is moved into the entries at boot. NVS skips values that match what is
+ * already stored and reclaims old entries when a sector fills up
+ * @return 0 once the change is durable, negative if flash is unchanged
+ */
+static int write_fields()
+{
+    if (config_fields_count(&pending_fields) == 0 && config_fields_count(&transaction.dirty_fields) == 1)
     {
-        LOG_ERR("Failed to re-read buffer after write");
-        return -4;
+        config_field_t field = 0;
+        while (!config_fields_has(&transaction.dirty_fields, field))
+        {
+            ++field;
+        }
+
+        int pos = find_field(field);
+        if (pos < 0 || nvs_write(&fs, FIELD_NVS_ID(field), &tlv.data[pos + 2], tlv.data[pos + 1]) < 0)
+        {
+            LOG_ERR("Failed to write '%s'", schema[field].name);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    write_crc();
+    if (nvs_write(&fs, CONFIG_NVS_ID, _buffer, SIZE_USED) < 0)
+    {
+        LOG_ERR("Failed to write commit record");
+        return -1;
+    }
+
+    config_fields_merge(&pending_fields, &transaction.dirty_fields);
+    for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+    {
+        if (!config_fields_has(&pending_fields, field))
+        {
+            continue;
+        }
+
+        int pos = find_field(field);
+        if (pos < 0 || nvs_write(&fs, FIELD_NVS_ID(field), &tlv.data[pos + 2], tlv.data[pos + 1]) < 0)
+        {
+            // The record holds the value until the next commit or boot writes the entry
+            LOG_WRN("Failed to write '%s', kept in the commit record", schema[field].name);
+            return 0;
+        }
+        config_fields_remove(&pending_fields, field);
+    }
+
+    if (nvs_delete(&fs, CONFIG_NVS_ID) != 0)
+    {
+        LOG_WRN("Failed to delete commit record");
     }
 
     return 0;
 }
 
-static int insert_value(int field_pos, config_field_t field, uint8_t size, void *value)
+static int insert_value(int field_pos, config_field_t field, uint8_t size, const void *value)
 {
-    const int bytes_to_insert = 2 + size;
+    uint8_t old_size = tlv.data[field_pos + 1];
+    const int bytes_to_insert = size - old_size;
     const int bytes_avaliable = SIZE_TLV_MAX - header->tlv_length;
     if (bytes_to_insert > bytes_avaliable)
     {
@@ -397,7 +799,6 @@ static int insert_value(int field_pos, config_field_t field, uint8_t size, void
         return -1;
     }
 
-    uint8_t old_size = tlv.data[field_pos + 1];
     if (memcmp(&tlv.data[field_pos + 2], value, size) != 0 || size != old_size)
     {
         if (size != old_size) // shift data
@@ -406,18 +807,24 @@ static int insert_value(int field_pos, config_field_t field, uint8_t size, void
             const int dest_idx = field_pos + 2 + size;
             const size_t move_size = header->tlv_length - (field_pos + 2 + old_size);
             memmove(&tlv.data[dest_idx], &tlv.data[src_idx], move_size);
+
+            // Only the stored entries behind this one moved, so walk them rather than every id
+            for (int pos = dest_idx; pos < header->tlv_length + bytes_to_insert; pos += tlv.data[pos + 1] + 2)
+            {
+                field_index[tlv.data[pos]] = pos;
+            }
         }
 
         tlv.data[field_pos] = field;
         tlv.data[field_pos + 1] = size;
         memcpy(&tlv.data[field_pos + 2], value, size);
-        header->tlv_length += size - old_size;
+        header->tlv_length += bytes_to_insert;
     }
 
     return size;
 }
 
-static int append_value(config_field_t field, uint8_t size, void *value)
+static int append_value(config_field_t field, uint8_t size, const void *value)
 {
     const int bytes_to_insert = 2 + size;
     const int bytes_avaliable = SIZE_TLV_MAX - header->tlv_length;
@@ -427,6 +834,7 @@ static int append_value(config_field_t field, uint8_t size, void *value)
         return -1;
     }
 
+    field_index[field] = header->tlv_length;
     tlv.data[header->tlv_length] = field;
     tlv.data[header->tlv_length + 1] = size;
     memcpy(&tlv.data[header->tlv_length + 2], value, size);
@@ -435,123 +843,239 @@ static int append_value(config_field_t field, uint8_t size, void *value)
     return size;
 }
 
-// TODO check bounds when passing in uint8_t length
-int config_read_u8(config_field_t field, uint8_t *value)
+static uint32_t decode_element(config_type_t type, const uint8_t *data)
 {
-    return read_value(field, sizeof(uint8_t), value);
+    switch (type)
+    {
+    case CONFIG_TYPE_U8:
+        return data[0];
+    case CONFIG_TYPE_U16:
+    {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    case CONFIG_TYPE_U32:
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    default:
+        return 0;
+    }
 }
 
-int config_read_u16(config_field_t field, uint16_t *value)
+static void encode_element(config_type_t type, uint32_t value, uint8_t *data)
 {
-    return read_value(field, sizeof(uint16_t), value);
+    switch (type)
+    {
+    case CONFIG_TYPE_U8:
+        data[0] = value;
+        break;
+    case CONFIG_TYPE_U16:
+    {
+        uint16_t narrow = value;
+        memcpy(data, &narrow, sizeof(narrow));
+        break;
+    }
+    case CONFIG_TYPE_U32:
+        memcpy(data, &value, sizeof(value));
+        break;
+    default:
+        break;
+    }
 }
 
-int config_read_u32(config_field_t field, uint32_t *value)
+const config_schema_t *config_schema(config_field_t field)
 {
-    return read_value(field, sizeof(uint32_t), value);
-}
+    if (field >= CONFIG_FIELD_MAX)
+    {
+        return NULL;
+    }
 
-int config_read_u64(config_field_t field, uint64_t *value)
-{
-    return read_value(field, sizeof(uint64_t), value);
+    return &schema[field];
 }
 
-int config_read_float(config_field_t field, float *value)
+int config_field_by_name(const char *name)
 {
-    return read_value(field, sizeof(float), value);
-}
+    for (int field = 0; field < CONFIG_FIELD_MAX; ++field)
+    {
+        if (strcmp(schema[field].name, name) == 0)
+        {
+            return field;
+        }
+    }
 
-int config_read_double(config_field_t field, double *value)
-{
-    return read_value(field, sizeof(double), value);
+    return -1;
 }
 
-int config_write_u8(config_field_t field, uint8_t value)
+size_t config_type_size(config_type_t type)
 {
-    return write_value(field, sizeof(uint8_t), &value);
-}
+    if (type >= CONFIG_TYPE_MAX)
+    {
+        return 0;
+    }
 
-int config_write_u16(config_field_t field, uint16_t value)
-{
-    return write_value(field, sizeof(uint16_t), &value);
+    return type_sizes[type];
 }
 
-int config_write_u32(config_field_t field, uint32_t value)
+size_t config_schema_size(config_field_t field)
 {
-    return write_value(field, sizeof(uint32_t), &value);
-}
+    if (field >= CONFIG_FIELD_MAX)
+    {
+        return 0;
+    }
 
-int config_write_u64(config_field_t field, uint64_t value)
-{
-    return write_value(field, sizeof(uint64_t), &value);
+    return config_type_size(schema[field].type) * schema[field].count;
 }
 
-int config_write_float(config_field_t field, float value)
+int config_get(config_field_t field, void *value, size_t size)
 {
-    return write_value(field, sizeof(float), &value);
-}
+    if (field >= CONFIG_FIELD_MAX || size != config_schema_size(field))
+    {
+        LOG_ERR("Invalid read of field %d with size %u", field, size);
+        return -4;
+    }
 
-int config_write_double(config_field_t field, double value)
-{
-    return write_value(field, sizeof(double), &value);
+    return read_value(field, size, value);
 }
 
-int config_read_u8_array(config_field_t field, uint8_t length, uint8_t *array)
+int config_set(config_field_t field, const void *value, size_t size)
 {
-    return read_value(field, sizeof(uint8_t) * length, array);
-}
+    if (field >= CONFIG_FIELD_MAX || size != config_schema_size(field))
+    {
+        LOG_ERR("Invalid write of field %d with size %u", field, size);
+        return -4;
+    }
 
-int config_read_u16_array(config_field_t field, uint8_t length, uint16_t *array)
-{
-    return read_value(field, sizeof(uint16_t) * length, array);
-}
+    const config_schema_t *entry = &schema[field];
+    const size_t element_size = config_type_size(entry->type);
+    for (int i = 0; i < entry->count; ++i)
+    {
+        uint32_t element = decode_element(entry->type, (const uint8_t *)value + i * element_size);
+        if (element < entry->min || element > entry->max)
+        {
+            LOG_ERR("Value %u of '%s' outside of [%u, %u]", element, entry->name, entry->min, entry->max);
+            return -5;
+        }
+    }
 
-int config_read_u32_array(config_field_t field, uint8_t length, uint32_t *array)
-{
-    return read_value(field, sizeof(uint32_t) * length, array);
+    return write_value(field, size, value);
 }
 
-int config_read_u64_array(config_field_t field, uint8_t length, uint64_t *array)
+int config_default(config_field_t field, void *value, size_t size)
 {
-    return read_value(field, sizeof(uint64_t) * length, array);
-}
+    if (field >= CONFIG_FIELD_MAX || size != config_schema_size(field))
+    {
+        return -1;
+    }
 
-int config_read_float_array(config_field_t field, uint8_t length, float *array)
-{
-    return read_value(field, sizeof(float) * length, array);
-}
+    const config_schema_t *entry = &schema[field];
+    const size_t element_size = config_type_size(entry->type);
+    for (int i = 0; i < entry->count; ++i)
+    {
+        encode_element(entry->type, entry->default_value, (uint8_t *)value + i * element_size);
+    }
 
-int config_read_double_array(config_field_t field, uint8_t length, double *array)
-{
-    return read_value(field, sizeof(double) * length, array);
+    return 0;
 }
 
-int config_write_u8_array(config_field_t field, uint8_t length, uint8_t *array)
+int config_get_element(config_field_t field, uint8_t index, uint32_t *value)
 {
-    return write_value(field, sizeof(uint8_t) * length, array);
-}
+    if (field >= CONFIG_FIELD_MAX || index >= schema[field].count)
+    {
+        return -1;
+    }
 
-int config_write_u16_array(config_field_t field, uint8_t length, uint16_t *array)
-{
-    return write_value(field, sizeof(uint16_t) * length, array);
+    uint8_t data[SIZE_VALUE_MAX];
+    int ret = config_get(field, data, config_schema_size(field));
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    *value = decode_element(schema[field].type, &data[index * config_type_size(schema[field].type)]);
+
+    return 0;
 }
 
-int config_write_u32_array(config_field_t field, uint8_t length, uint32_t *array)
+int config_apply_tlv(const uint8_t *tlv, size_t length)
 {
-    return write_value(field, sizeof(uint32_t) * length, array);
+    config_begin();
+
+    size_t pos = 0;
+    while (pos < length)
+    {
+        if (pos + 2 > length || pos + 2 + tlv[pos + 1] > length)
+        {
+            LOG_ERR("Malformed TLV record at %u", pos);
+            config_abort();
+            return -1;
+        }
+
+        if (config_set(tlv[pos], &tlv[pos + 2], tlv[pos + 1]) != 0)
+        {
+            config_abort();
+            return -2;
+        }
+        pos += tlv[pos + 1] + 2;
+    }
+
+    int ret = config_commit();
+    if (ret != 0)
+    {
+        // A validator rejecting the combination counts as a rejected record
+        return ret == -4 ? -2 : -3;
+    }
+
+    return 0;
 }
 
-int config_write_u64_array(config_field_t field, uint8_t length, uint64_t *array)
+bool config_is_image(const uint8_t *buffer, size_t length)
 {
-    return write_value(field, sizeof(uint64_t) * length, array);
+    const uint16_t magic = (MAGIC);
+    return length >= SIZE_HEADER + SIZE_TAIL && memcmp(&buffer[OFFSET_MAGIC], &magic, sizeof(uint16_t)) == 0;
 }
 
-int config_write_float_array(config_field_t field, uint8_t length, float *array)
+int config_apply_image(const uint8_t *image, size_t length)
 {
-    return write_value(field, sizeof(float) * length, array);
+    if (!config_is_image(image, length))
+    {
+        LOG_ERR("Image magic not found");
+        return -4;
+    }
+
+    config_header_t image_header;
+    memcpy(&image_header, image, sizeof(image_header));
+    if (image_header.major_version != VERSION_MAJOR)
+    {
+        LOG_ERR("Unsupported image version %u.%u", image_header.major_version, image_header.minor_version);
+        return -4;
+    }
+    if (SIZE_HEADER + image_header.tlv_length + SIZE_TAIL != length)
+    {
+        LOG_ERR("Image length mismatch. Got '%u', expected '%u'", length, SIZE_HEADER + image_header.tlv_length + SIZE_TAIL);
+        return -4;
+    }
+
+    uint32_t image_checksum;
+    memcpy(&image_checksum, &image[SIZE_HEADER + image_header.tlv_length], sizeof(uint32_t));
+    if (image_checksum != crc32_ieee(image, SIZE_HEADER + image_header.tlv_length))
+    {
+        LOG_ERR("Image checksum mismatch");
+        return -4;
+    }
+
+    return config_apply_tlv(&image[SIZE_HEADER], image_header.tlv_length);
 }
 
-int config_write_double_array(config_field_t field, uint8_t length, double *array)
+uint32_t config_crc()
 {
-    return write_value(field, sizeof(double) * length, array);
+    uint32_t checksum;
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    memcpy(&checksum, &_committed[SIZE_HEADER + ((config_header_t *)_committed)->tlv_length], sizeof(uint32_t));
+    k_mutex_unlock(&config_mutex);
+
+    return checksum;
 }
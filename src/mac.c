@@ -0,0 +1,174 @@
+/**
+ * @file mac.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mac.h"
+
+#include "ramfunc.h"
+
+static size_t address_size(mac_addr_mode_t mode);
+
+static size_t address_size(mac_addr_mode_t mode)
+{
+    switch (mode)
+    {
+    case MAC802154_ADDR_MODE_SHORT:
+        return MAC802154_SHORT_ADDRESS_SIZE;
+    case MAC802154_ADDR_MODE_EXTENDED:
+        return MAC802154_EXTENDED_ADDRESS_SIZE;
+    default:
+        return 0;
+    }
+}
+
+size_t mac_frame_header_size(const mac_frame_t *frame)
+{
+    size_t size = MAC802154_FRAME_CONTROL_SIZE + MAC802154_SEQUENCE_NUMBER_SIZE;
+
+    if (frame->dest.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        size += MAC802154_PAN_ID_SIZE + address_size(frame->dest.mode);
+    }
+    if (frame->src.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        if (!(frame->pan_id_compression && frame->dest.mode != MAC802154_ADDR_MODE_NONE))
+        {
+            size += MAC802154_PAN_ID_SIZE;
+        }
+        size += address_size(frame->src.mode);
+    }
+
+    return size;
+}
+
+int mac_frame_write(const mac_frame_t *frame, uint8_t *buffer, size_t size)
+{
+    const size_t header_size = mac_frame_header_size(frame);
+    const size_t frame_size = header_size + frame->payload_length + MAC802154_FCS_SIZE;
+    if (frame_size > MAC802154_FRAME_SIZE_MAX || frame_size > size)
+    {
+        return -1;
+    }
+
+    mac_frame_control_t frame_control = {0};
+    frame_control.fields.frame_type = frame->type;
+    frame_control.fields.pan_id = frame->pan_id_compression ? 1 : 0;
+    frame_control.fields.dest_addr_mode = frame->dest.mode;
+    frame_control.fields.frame_version = 1;
+    frame_control.fields.src_addr_mode = frame->src.mode;
+
+    size_t pos = 0;
+    memcpy(&buffer[pos], &frame_control.raw, MAC802154_FRAME_CONTROL_SIZE);
+    pos += MAC802154_FRAME_CONTROL_SIZE;
+    buffer[pos++] = frame->sequence_number;
+
+    if (frame->dest.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        memcpy(&buffer[pos], &frame->dest_pan_id, MAC802154_PAN_ID_SIZE);
+        pos += MAC802154_PAN_ID_SIZE;
+        memcpy(&buffer[pos], &frame->dest.short_address, address_size(frame->dest.mode));
+        pos += address_size(frame->dest.mode);
+    }
+    if (frame->src.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        if (!(frame->pan_id_compression && frame->dest.mode != MAC802154_ADDR_MODE_NONE))
+        {
+            memcpy(&buffer[pos], &frame->src_pan_id, MAC802154_PAN_ID_SIZE);
+            pos += MAC802154_PAN_ID_SIZE;
+        }
+        memcpy(&buffer[pos], &frame->src.short_address, address_size(frame->src.mode));
+        pos += address_size(frame->src.mode);
+    }
+
+    if (frame->payload_length > 0)
+    {
+        memcpy(&buffer[pos], frame->payload, frame->payload_length);
+        pos += frame->payload_length;
+    }
+
+    return pos + MAC802154_FCS_SIZE;
+}
+
+TDOA_RAMFUNC int mac_frame_read(mac_frame_t *frame, uint8_t *buffer, size_t length)
+{
+    if (length < MAC802154_FRAME_CONTROL_SIZE + MAC802154_SEQUENCE_NUMBER_SIZE + MAC802154_FCS_SIZE ||
+        length > MAC802154_FRAME_SIZE_MAX)
+    {
+        return -1;
+    }
+
+    mac_frame_control_t frame_control;
+    memcpy(&frame_control.raw, buffer, MAC802154_FRAME_CONTROL_SIZE);
+    if (frame_control.fields.security_enabled)
+    {
+        return -2;
+    }
+
+    memset(frame, 0, sizeof(mac_frame_t));
+    frame->type = frame_control.fields.frame_type;
+    frame->pan_id_compression = frame_control.fields.pan_id;
+    frame->dest.mode = frame_control.fields.dest_addr_mode;
+    frame->src.mode = frame_control.fields.src_addr_mode;
+    frame->sequence_number = buffer[MAC802154_FRAME_CONTROL_SIZE];
+
+    const size_t header_size = mac_frame_header_size(frame);
+    if (header_size + MAC802154_FCS_SIZE > length)
+    {
+        return -3;
+    }
+
+    size_t pos = MAC802154_FRAME_CONTROL_SIZE + MAC802154_SEQUENCE_NUMBER_SIZE;
+    if (frame->dest.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        memcpy(&frame->dest_pan_id, &buffer[pos], MAC802154_PAN_ID_SIZE);
+        pos += MAC802154_PAN_ID_SIZE;
+        memcpy(&frame->dest.short_address, &buffer[pos], address_size(frame->dest.mode));
+        pos += address_size(frame->dest.mode);
+    }
+    if (frame->src.mode != MAC802154_ADDR_MODE_NONE)
+    {
+        if (frame->pan_id_compression && frame->dest.mode != MAC802154_ADDR_MODE_NONE)
+        {
+            frame->src_pan_id = frame->dest_pan_id;
+        }
+        else
+        {
+            memcpy(&frame->src_pan_id, &buffer[pos], MAC802154_PAN_ID_SIZE);
+            pos += MAC802154_PAN_ID_SIZE;
+        }
+        memcpy(&frame->src.short_address, &buffer[pos], address_size(frame->src.mode));
+        pos += address_size(frame->src.mode);
+    }
+
+    frame->payload = &buffer[pos];
+    frame->payload_length = length - pos - MAC802154_FCS_SIZE;
+
+    return 0;
+}
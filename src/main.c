@@ -29,21 +29,40 @@
  *
  */
 
+#include "boot.h"
 #include "config.h"
 #include "deca_device_api.h"
+#include "telemetry.h"
 #include "uwb.h"
 
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/sys/crc.h>
 
-LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(main, CONFIG_TDOA_MAIN_LOG_LEVEL);
 
 int main(void)
 {
-    k_msleep(1000);
+    boot_mark(BOOT_PHASE_MAIN);
 
     int ret;
+    ret = telemetry_init();
+    if (ret == -1)
+    {
+        LOG_WRN("No tdoa,telemetry-uart chosen, telemetry is not streamed");
+    }
+    else if (ret != 0)
+    {
+        LOG_WRN("Telemetry UART not ready, telemetry is not streamed");
+    }
+
+    ret = uwb_init();
+    if (ret != 0)
+    {
+        LOG_ERR("Failed to initalize uwb: %d", ret);
+        return -2;
+    }
+
     ret = config_init();
     if (ret != 0)
     {
@@ -51,16 +70,14 @@ int main(void)
         return -1;
     }
 
-    ret = uwb_init();
+    ret = uwb_start();
     if (ret != 0)
     {
-        LOG_ERR("Failed to initalize uwb: %d", ret);
-        return -2;
+        LOG_ERR("Failed to start uwb: %d", ret);
+        return -3;
     }
 
     LOG_DBG("Initialized uwb");
 
-    uwb_start();
-
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+/**
+ * @file telemetry.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "telemetry.h"
+
+#include <stdbool.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#if DT_HAS_CHOSEN(tdoa_telemetry_uart)
+#define TELEMETRY_UART_NODE DT_CHOSEN(tdoa_telemetry_uart)
+#elif defined(CONFIG_TDOA_TELEMETRY_CONSOLE)
+#define TELEMETRY_UART_NODE DT_CHOSEN(zephyr_console)
+#endif
+
+#define TELEMETRY_STACK_SIZE 1024
+#define TELEMETRY_PRIORITY K_LOWEST_APPLICATION_THREAD_PRIO
+#define TELEMETRY_UART_CHUNK 64
+
+K_THREAD_STACK_DEFINE(telemetry_stack_area, TELEMETRY_STACK_SIZE);
+static struct k_thread telemetry_thread;
+static K_SEM_DEFINE(telemetry_sem, 0, 1);
+
+RING_BUF_DECLARE(telemetry_ring, CONFIG_TDOA_TELEMETRY_BUFFER_SIZE);
+#ifdef TELEMETRY_UART_NODE
+static const struct device *const telemetry_uart = DEVICE_DT_GET(TELEMETRY_UART_NODE);
+#else
+static const struct device *const telemetry_uart = NULL;
+#endif
+static bool telemetry_started;
+
+// Guards the ring buffer and the statistics
+static struct k_spinlock telemetry_lock;
+static telemetry_stats_t stats;
+
+static void telemetry_thread_main(void *, void *, void *);
+
+int telemetry_init()
+{
+    if (telemetry_uart == NULL)
+    {
+        return -1;
+    }
+
+    if (!device_is_ready(telemetry_uart))
+    {
+        return -2;
+    }
+
+    k_tid_t telemetry_tid = k_thread_create(&telemetry_thread, telemetry_stack_area,
+                                            K_THREAD_STACK_SIZEOF(telemetry_stack_area),
+                                            telemetry_thread_main,
+                                            NULL, NULL, NULL,
+                                            TELEMETRY_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(telemetry_tid, "telemetry");
+    telemetry_started = true;
+
+    return 0;
+}
+
+int telemetry_send(telemetry_record_t type, uint8_t *record, uint16_t payload_length)
+{
+    const size_t size = TELEMETRY_RECORD_SIZE(payload_length);
+
+    sys_put_le16(TELEMETRY_MAGIC, &record[0]);
+    record[2] = type;
+    sys_put_le16(payload_length, &record[3]);
+    sys_put_le32(crc32_ieee(record, TELEMETRY_HEADER_SIZE + payload_length), &record[TELEMETRY_HEADER_SIZE + payload_length]);
+
+    int ret = 0;
+    k_spinlock_key_t key = k_spin_lock(&telemetry_lock);
+    if (telemetry_started && ring_buf_space_get(&telemetry_ring) >= size)
+    {
+        ring_buf_put(&telemetry_ring, record, size);
+        ++stats.records;
+    }
+    else
+    {
+        ++stats.dropped;
+        ret = -1;
+    }
+    k_spin_unlock(&telemetry_lock, key);
+
+    k_sem_give(&telemetry_sem);
+
+    return ret;
+}
+
+bool telemetry_streaming()
+{
+    return telemetry_started;
+}
+
+void telemetry_stats(telemetry_stats_t *copy)
+{
+    k_spinlock_key_t key = k_spin_lock(&telemetry_lock);
+    *copy = stats;
+    k_spin_unlock(&telemetry_lock, key);
+}
+
+static void telemetry_thread_main(void *, void *, void *)
+{
+    while (1)
+    {
+        k_sem_take(&telemetry_sem, K_FOREVER);
+
+        while (1)
+        {
+            uint8_t *data;
+            k_spinlock_key_t key = k_spin_lock(&telemetry_lock);
+            uint32_t size = ring_buf_get_claim(&telemetry_ring, &data, TELEMETRY_UART_CHUNK);
+            k_spin_unlock(&telemetry_lock, key);
+            if (size == 0)
+            {
+                break;
+            }
+
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                uart_poll_out(telemetry_uart, data[i]);
+            }
+
+            key = k_spin_lock(&telemetry_lock);
+            ring_buf_get_finish(&telemetry_ring, size);
+            stats.streamed_bytes += size;
+            k_spin_unlock(&telemetry_lock, key);
+        }
+    }
+}
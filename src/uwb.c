@@ -31,25 +31,40 @@
 
 #include "uwb.h"
 
+#include "boot.h"
 #include "deca_device_api.h"
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
-
+#include "ramfunc.h"
+#include "uwb_airtime.h"
+#include "uwb_cir.h"
+#include "uwb_events.h"
+#include "uwb_phy.h"
+#include "uwb_stats.h"
+#include "uwb_time.h"
+#include "uwb_xtal.h"
+
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/kernel/thread.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/sem.h>
 
-LOG_MODULE_REGISTER(uwb, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(uwb, CONFIG_TDOA_UWB_LOG_LEVEL);
 
 #define UWB_STACK_SIZE 2048
 #define UWB_PRIORITY 0
+// The DW1000 answers on SPI a few ms after power-up, bounded by the 1 s the firmware used to sleep
+#define RADIO_READY_TIMEOUT_MS 1000
+#define RADIO_READY_POLL_MS 2
+// Preamble accumulation count without saturation, missing from deca_regs.h (user manual 7.2.40.11)
+#define DRX_RXPACC_NOSAT_OFFSET 0x2C
 
 K_THREAD_STACK_DEFINE(uwb_stack_area, UWB_STACK_SIZE);
 
-#define TX_ANTENNA_DELAY 16436
-#define RX_ANTENNA_DELAY 16436
+_Static_assert(CONFIG_MODE_DEFAULT == UWB_MODE_DUMMY, "Default config mode must be dummy");
 
 extern uwb_algorithm_t uwb_tag_algorithm;
 extern uwb_algorithm_t uwb_anchor_algorithm;
@@ -60,39 +75,155 @@ struct
     uwb_algorithm_t *algorithm;
     char *name;
 } uwb_available_algorithms[] = {
-    {.algorithm = &uwb_tag_algorithm, .name = "tag"},
-    {.algorithm = &uwb_anchor_algorithm, .name = "anchor"},
-    {.algorithm = &uwb_dummy_algorithm, .name = "dummy"},
-    {NULL, NULL}};
+    // Algorithms left out of the image keep their name but have no implementation
+    [UWB_MODE_TAG] = {.algorithm = IS_ENABLED(CONFIG_TDOA_TAG) ? &uwb_tag_algorithm : NULL, .name = "tag"},
+    [UWB_MODE_ANCHOR] = {.algorithm = IS_ENABLED(CONFIG_TDOA_ANCHOR) ? &uwb_anchor_algorithm : NULL, .name = "anchor"},
+    [UWB_MODE_DUMMY] = {.algorithm = &uwb_dummy_algorithm, .name = "dummy"},
+    [UWB_MODE_MAX] = {NULL, NULL}};
 
 static uwb_algorithm_t *algorithm = &uwb_dummy_algorithm;
 static uint32_t timeout_ms = 0;
 
-static dwt_config_t dwt_config = {
-    5,               /* Channel number. */
-    DWT_PRF_64M,     /* Pulse repetition frequency. */
-    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
-    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
-    9,               /* TX preamble code. Used in TX only. */
-    9,               /* RX preamble code. Used in RX only. */
-    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
-    DWT_BR_6M8,      /* Data rate. */
-    DWT_PHRMODE_EXT, /* PHY header mode. */
-    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
-};
-
 K_SEM_DEFINE(uwb_irq_sem, 0, 1);
+K_SEM_DEFINE(uwb_radio_ready_sem, 0, 1);
+K_SEM_DEFINE(uwb_start_sem, 0, 1);
+
+#define UWB_TX_QUEUE_SIZE 4
+
+typedef struct
+{
+    uint16_t dest_address;
+    uint8_t length;
+    uint8_t payload[UWB_PAYLOAD_SIZE_MAX];
+} uwb_tx_request_t;
+
+K_MSGQ_DEFINE(uwb_tx_queue, sizeof(uwb_tx_request_t), UWB_TX_QUEUE_SIZE, 4);
+
+static struct k_thread uwb_thread;
+static int radio_status;
+// Set once the uwb loop runs and serves requests from other threads
+static atomic_t radio_running;
 
 static uwb_config_t uwb_config;
+static uint8_t sequence_numbers[UWB_MODE_MAX];
+
+// DW1000 time at the end of the last received frame and the timer capture of its interrupt edge
+static struct
+{
+    bool valid;
+    uint64_t device_time;
+    uint32_t mcu_ticks;
+} correlation;
+// Fields committed since the uwb thread last applied the configuration
+static struct k_spinlock config_changed_lock;
+static config_fields_t config_changed;
+// Set when a crystal trim calibration should take over the radio
+static atomic_t xtal_requested;
+// Crystal trim loaded from OTP by the driver
+static uint8_t factory_xtal_trim;
+// A started frame, queued or armed by the algorithm and possibly delayed, holds back queued
+// frames until its TX done event. The deadline only releases them when that event never comes,
+// such as after the algorithm forced the transceiver off
+#define TX_DONE_MARGIN_MS 2
+static int64_t tx_deadline_ms = -1;
+// Length of the frame last written to the TX buffer
+static int tx_length;
+
+#define UWB_CONFIG_FIELDS CONFIG_FIELDS(CONFIG_FIELD_MODE,             \
+                                        CONFIG_FIELD_ADDRESS,          \
+                                        CONFIG_FIELD_ANCHOR_X_POS_MM,  \
+                                        CONFIG_FIELD_ANCHOR_Y_POS_MM,  \
+                                        CONFIG_FIELD_ANCHOR_Z_POS_MM,  \
+                                        CONFIG_FIELD_TX_ANTENNA_DELAY, \
+                                        CONFIG_FIELD_RX_ANTENNA_DELAY, \
+                                        CONFIG_FIELD_PHY_PROFILE,      \
+                                        CONFIG_FIELD_SYNC_INTERVAL_MS, \
+                                        CONFIG_FIELD_ANCHOR_COUNT,     \
+                                        CONFIG_FIELD_XTAL_TRIM)
+
+// Fields that together decide whether the anchors fit on the channel
+#define UWB_SCHEDULE_FIELDS CONFIG_FIELDS(CONFIG_FIELD_PHY_PROFILE,      \
+                                          CONFIG_FIELD_SYNC_INTERVAL_MS, \
+                                          CONFIG_FIELD_ANCHOR_COUNT)
 
 static void uwb_isr(void);
 static void rx_ok_callback(const dwt_cb_data_t *cb_data);
 static void rx_timeout_callback(const dwt_cb_data_t *cb_data);
 static void rx_error_callback(const dwt_cb_data_t *cb_data);
 static void tx_done_callback(const dwt_cb_data_t *cb_data);
-static void uwb_loop(void *, void *, void *);
+static int wait_for_device();
+static int radio_init();
+static void load_field(config_field_t field, void *value, size_t size);
+static void load_config();
+static int validate_mode(const config_fields_t *fields);
+static int validate_address(const config_fields_t *fields);
+static int validate_schedule(const config_fields_t *fields);
+static void on_config_commit(const config_fields_t *fields);
+static void apply_config(const config_fields_t *fields);
+static void apply_xtal_trim();
+static void switch_algorithm(uwb_algorithm_t *next);
+static void radio_off();
+static void send_queued();
+static void hold_queue(uint32_t delay_us);
+static void uwb_thread_main(void *, void *, void *);
+static void uwb_loop();
 
 int uwb_init()
+{
+    k_tid_t uwb_tid = k_thread_create(&uwb_thread, uwb_stack_area,
+                                      K_THREAD_STACK_SIZEOF(uwb_stack_area),
+                                      uwb_thread_main,
+                                      NULL, NULL, NULL,
+                                      UWB_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(uwb_tid, "uwb");
+
+    // let radio bring-up run until its first driver sleep, the caller loads config meanwhile
+    k_yield();
+
+    return 0;
+}
+
+int uwb_start()
+{
+    k_sem_take(&uwb_radio_ready_sem, K_FOREVER);
+    if (radio_status != 0)
+    {
+        LOG_ERR("Radio failed to initialize: %d", radio_status);
+        return radio_status;
+    }
+
+    load_config();
+    const dwt_config_t *phy = &uwb_phy_profile(uwb_config.phy_profile)->config;
+    if (uwb_airtime_check(phy, uwb_config.anchor_count, uwb_config.sync_interval_ms) != 0)
+    {
+        LOG_WRN("%u anchors oversubscribe the channel at a %u ms sync interval", uwb_config.anchor_count, uwb_config.sync_interval_ms);
+    }
+    config_validate(CONFIG_FIELDS(CONFIG_FIELD_MODE), validate_mode);
+    config_validate(CONFIG_FIELDS(CONFIG_FIELD_ADDRESS), validate_address);
+    config_validate(UWB_SCHEDULE_FIELDS, validate_schedule);
+    config_observe(UWB_CONFIG_FIELDS, on_config_commit);
+    k_sem_give(&uwb_start_sem);
+
+    return 0;
+}
+
+static int wait_for_device()
+{
+    const int64_t start_ms = k_uptime_get();
+    while (dwt_readdevid() != DWT_DEVICE_ID)
+    {
+        if (k_uptime_get() - start_ms >= RADIO_READY_TIMEOUT_MS)
+        {
+            return -1;
+        }
+        k_msleep(RADIO_READY_POLL_MS);
+    }
+    LOG_DBG("DW1000 ready after %lld ms", k_uptime_get() - start_ms);
+
+    return 0;
+}
+
+static int radio_init()
 {
     if (openspi() != DWT_SUCCESS)
     {
@@ -100,17 +231,20 @@ int uwb_init()
         return -1;
     }
     port_set_dw1000_slowrate();
+    if (wait_for_device() != 0)
+    {
+        LOG_ERR("DW1000 not responding, device id %08x", dwt_readdevid());
+        return -2;
+    }
     if (dwt_initialise(DWT_LOADUCODE) != DWT_SUCCESS)
     {
         LOG_ERR("Failed to initialize deca");
-        return -2;
+        return -3;
     }
     port_set_dw1000_fastrate();
+    factory_xtal_trim = dwt_getxtaltrim();
 
-    dwt_configure(&dwt_config);
-
-    dwt_settxantennadelay(TX_ANTENNA_DELAY);
-    dwt_setrxantennadelay(RX_ANTENNA_DELAY);
+    uwb_phy_apply(UWB_PHY_PROFILE_DEFAULT);
 
     port_set_deca_isr(uwb_isr);
 
@@ -123,47 +257,208 @@ int uwb_init()
 
     dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
 
-    if (config_read_u8(CONFIG_FIELD_MODE, &uwb_config.mode) != 0)
+    return 0;
+}
+
+static void load_field(config_field_t field, void *value, size_t size)
+{
+    if (config_get(field, value, size) != 0)
     {
-        LOG_WRN("Failed to read UWB mode from configuration, defaulting to '%s'", uwb_mode_name(UWB_MODE_DUMMY));
-        uwb_config.mode = UWB_MODE_DUMMY;
+        LOG_WRN("Failed to read '%s' from configuration, using default", config_schema(field)->name);
+        config_default(field, value, size);
     }
-    if (uwb_config.mode < uwb_mode_count())
+}
+
+static void load_config()
+{
+    load_field(CONFIG_FIELD_MODE, &uwb_config.mode, sizeof(uwb_config.mode));
+    if (uwb_mode_available(uwb_config.mode))
     {
         algorithm = uwb_available_algorithms[uwb_config.mode].algorithm;
     }
-    if (config_read_u8_array(CONFIG_FIELD_ADDRESS, 8, uwb_config.address) != 0)
+    else
     {
-        LOG_WRN("Failed to read UWB address from configuration, defaulting to '0xffffffff'");
+        LOG_WRN("Mode '%s' is not built into this image, staying idle", uwb_mode_name(uwb_config.mode));
+        uwb_config.mode = UWB_MODE_DUMMY;
     }
-    if (uwb_config.mode == UWB_MODE_ANCHOR)
+    load_field(CONFIG_FIELD_ADDRESS, uwb_config.address, sizeof(uwb_config.address));
+    uwb_config.short_address = mac_short_address(uwb_config.address);
+    if (uwb_config.short_address == MAC802154_BROADCAST_ADDRESS)
     {
-        if (config_read_u32(CONFIG_FIELD_ANCHOR_X_POS_MM, &uwb_config.anchor_x_pos_mm) != 0)
+        LOG_WRN("Short address is the broadcast address %04x, set a unique address", uwb_config.short_address);
+    }
+    load_field(CONFIG_FIELD_ANCHOR_X_POS_MM, &uwb_config.anchor_x_pos_mm, sizeof(uwb_config.anchor_x_pos_mm));
+    load_field(CONFIG_FIELD_ANCHOR_Y_POS_MM, &uwb_config.anchor_y_pos_mm, sizeof(uwb_config.anchor_y_pos_mm));
+    load_field(CONFIG_FIELD_ANCHOR_Z_POS_MM, &uwb_config.anchor_z_pos_mm, sizeof(uwb_config.anchor_z_pos_mm));
+    load_field(CONFIG_FIELD_TX_ANTENNA_DELAY, &uwb_config.tx_antenna_delay, sizeof(uwb_config.tx_antenna_delay));
+    load_field(CONFIG_FIELD_RX_ANTENNA_DELAY, &uwb_config.rx_antenna_delay, sizeof(uwb_config.rx_antenna_delay));
+    load_field(CONFIG_FIELD_PHY_PROFILE, &uwb_config.phy_profile, sizeof(uwb_config.phy_profile));
+    load_field(CONFIG_FIELD_SYNC_INTERVAL_MS, &uwb_config.sync_interval_ms, sizeof(uwb_config.sync_interval_ms));
+    load_field(CONFIG_FIELD_ANCHOR_COUNT, &uwb_config.anchor_count, sizeof(uwb_config.anchor_count));
+    load_field(CONFIG_FIELD_XTAL_TRIM, &uwb_config.xtal_trim, sizeof(uwb_config.xtal_trim));
+}
+
+/**
+ * @brief Reject modes whose algorithm is not built into this image
+ */
+static int validate_mode(const config_fields_t *fields)
+{
+    uint8_t mode;
+    load_field(CONFIG_FIELD_MODE, &mode, sizeof(mode));
+    if (!uwb_mode_available(mode))
+    {
+        LOG_ERR("Mode '%s' is not built into this image", uwb_mode_name(mode));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Reject addresses whose short address is the broadcast address
+ */
+static int validate_address(const config_fields_t *fields)
+{
+    uint8_t address[sizeof(uwb_config.address)];
+    load_field(CONFIG_FIELD_ADDRESS, address, sizeof(address));
+    if (mac_short_address(address) == MAC802154_BROADCAST_ADDRESS)
+    {
+        LOG_ERR("Short address %04x is the broadcast address", MAC802154_BROADCAST_ADDRESS);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Reject a PHY profile, sync interval and anchor count combination in
+ * which the anchor slots do not fit in the sync interval
+ */
+static int validate_schedule(const config_fields_t *fields)
+{
+    uint8_t profile;
+    uint16_t sync_interval_ms;
+    uint8_t anchor_count;
+    load_field(CONFIG_FIELD_PHY_PROFILE, &profile, sizeof(profile));
+    load_field(CONFIG_FIELD_SYNC_INTERVAL_MS, &sync_interval_ms, sizeof(sync_interval_ms));
+    load_field(CONFIG_FIELD_ANCHOR_COUNT, &anchor_count, sizeof(anchor_count));
+
+    const dwt_config_t *phy = &uwb_phy_profile(profile)->config;
+    if (uwb_airtime_check(phy, anchor_count, sync_interval_ms) != 0)
+    {
+        LOG_ERR("%u anchors need a sync interval of at least %u us with profile '%s'",
+                anchor_count,
+                uwb_airtime_min_sync_interval_us(phy, anchor_count),
+                uwb_phy_profile(profile)->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void on_config_commit(const config_fields_t *fields)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_changed_lock);
+    config_fields_merge(&config_changed, fields);
+    k_spin_unlock(&config_changed_lock, key);
+    // Wake the uwb thread, a spurious dwt_isr() with no pending events is harmless
+    k_sem_give(&uwb_irq_sem);
+}
+
+/**
+ * @brief Apply committed configuration changes in the uwb thread. Addresses,
+ * positions and the sync interval are read by the algorithms on their next TX. A PHY profile
+ * change reconfigures the DW1000 and lets the algorithm restart the radio. A
+ * mode change stops the radio and starts the new algorithm without
+ * reinitializing the DW1000
+ */
+static void apply_config(const config_fields_t *fields)
+{
+    if (config_fields_has(fields, CONFIG_FIELD_ADDRESS))
+    {
+        load_field(CONFIG_FIELD_ADDRESS, uwb_config.address, sizeof(uwb_config.address));
+        uwb_config.short_address = mac_short_address(uwb_config.address);
+        LOG_INF("Address changed to %04x", uwb_config.short_address);
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_ANCHOR_X_POS_MM))
+    {
+        load_field(CONFIG_FIELD_ANCHOR_X_POS_MM, &uwb_config.anchor_x_pos_mm, sizeof(uwb_config.anchor_x_pos_mm));
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_ANCHOR_Y_POS_MM))
+    {
+        load_field(CONFIG_FIELD_ANCHOR_Y_POS_MM, &uwb_config.anchor_y_pos_mm, sizeof(uwb_config.anchor_y_pos_mm));
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_ANCHOR_Z_POS_MM))
+    {
+        load_field(CONFIG_FIELD_ANCHOR_Z_POS_MM, &uwb_config.anchor_z_pos_mm, sizeof(uwb_config.anchor_z_pos_mm));
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_TX_ANTENNA_DELAY))
+    {
+        load_field(CONFIG_FIELD_TX_ANTENNA_DELAY, &uwb_config.tx_antenna_delay, sizeof(uwb_config.tx_antenna_delay));
+        dwt_settxantennadelay(uwb_config.tx_antenna_delay);
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_RX_ANTENNA_DELAY))
+    {
+        load_field(CONFIG_FIELD_RX_ANTENNA_DELAY, &uwb_config.rx_antenna_delay, sizeof(uwb_config.rx_antenna_delay));
+        dwt_setrxantennadelay(uwb_config.rx_antenna_delay);
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_PHY_PROFILE))
+    {
+        load_field(CONFIG_FIELD_PHY_PROFILE, &uwb_config.phy_profile, sizeof(uwb_config.phy_profile));
+        if (uwb_config.phy_profile != uwb_phy_current())
         {
-            LOG_WRN("Failed to read anchor x position, defaulting to '0'");
-            uwb_config.anchor_x_pos_mm = 0;
+            radio_off();
+            uwb_phy_apply(uwb_config.phy_profile);
+            dwt_settxantennadelay(uwb_config.tx_antenna_delay);
+            dwt_setrxantennadelay(uwb_config.rx_antenna_delay);
+            // let the algorithm restart reception or transmission
+            timeout_ms = 0;
         }
-        if (config_read_u32(CONFIG_FIELD_ANCHOR_Y_POS_MM, &uwb_config.anchor_y_pos_mm) != 0)
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_SYNC_INTERVAL_MS))
+    {
+        load_field(CONFIG_FIELD_SYNC_INTERVAL_MS, &uwb_config.sync_interval_ms, sizeof(uwb_config.sync_interval_ms));
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_ANCHOR_COUNT))
+    {
+        load_field(CONFIG_FIELD_ANCHOR_COUNT, &uwb_config.anchor_count, sizeof(uwb_config.anchor_count));
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_XTAL_TRIM))
+    {
+        load_field(CONFIG_FIELD_XTAL_TRIM, &uwb_config.xtal_trim, sizeof(uwb_config.xtal_trim));
+        if (algorithm != &uwb_xtal_algorithm)
+        {
+            apply_xtal_trim();
+        }
+    }
+    if (config_fields_has(fields, CONFIG_FIELD_MODE))
+    {
+        uint8_t mode;
+        load_field(CONFIG_FIELD_MODE, &mode, sizeof(mode));
+        if (mode != uwb_config.mode && uwb_mode_available(mode))
         {
-            LOG_WRN("Failed to read anchor y position, defaulting to '0'");
-            uwb_config.anchor_y_pos_mm = 0;
+            LOG_INF("Switching mode from '%s' to '%s'", uwb_mode_name(uwb_config.mode), uwb_mode_name(mode));
+            uwb_config.mode = mode;
+            // a running calibration resumes the new mode when it is done
+            if (algorithm != &uwb_xtal_algorithm)
+            {
+                switch_algorithm(uwb_available_algorithms[mode].algorithm);
+            }
         }
     }
+}
 
-    return 0;
+static void apply_xtal_trim()
+{
+    dwt_setxtaltrim(uwb_config.xtal_trim == CONFIG_XTAL_TRIM_FACTORY ? factory_xtal_trim : uwb_config.xtal_trim);
 }
 
-void uwb_start()
+static void switch_algorithm(uwb_algorithm_t *next)
 {
+    radio_off();
+    algorithm = next;
     algorithm->init(&uwb_config);
-
-    struct k_thread uwb_thread;
-    k_tid_t uwb_tid = k_thread_create(&uwb_thread, uwb_stack_area,
-                                      K_THREAD_STACK_SIZEOF(uwb_stack_area),
-                                      uwb_loop,
-                                      NULL, NULL, NULL,
-                                      UWB_PRIORITY, 0, K_NO_WAIT);
-    k_thread_name_set(uwb_tid, "uwb");
+    timeout_ms = 0;
 }
 
 int uwb_mode_count()
@@ -171,6 +466,11 @@ int uwb_mode_count()
     return UWB_MODE_MAX;
 }
 
+bool uwb_mode_available(uwb_mode_t mode)
+{
+    return mode < uwb_mode_count() && uwb_available_algorithms[mode].algorithm != NULL;
+}
+
 char *uwb_mode_name(uwb_mode_t mode)
 {
     if (mode >= uwb_mode_count())
@@ -181,31 +481,351 @@ char *uwb_mode_name(uwb_mode_t mode)
     return uwb_available_algorithms[mode].name;
 }
 
-static void uwb_loop(void *, void *, void *)
+int uwb_time_correlation(uint64_t *device_time, uint32_t *mcu_ticks)
+{
+    int ret = -1;
+    port_dw1000_lock();
+    if (correlation.valid)
+    {
+        *device_time = correlation.device_time;
+        *mcu_ticks = correlation.mcu_ticks;
+        ret = 0;
+    }
+    port_dw1000_unlock();
+
+    return ret;
+}
+
+uint16_t uwb_short_address()
+{
+    return uwb_config.short_address;
+}
+
+int uwb_write_frame(mac_frame_t *frame)
+{
+    static uint8_t tx_buffer[MAC802154_FRAME_SIZE_MAX];
+
+    if (uwb_config.mode < UWB_MODE_MAX)
+    {
+        frame->sequence_number = sequence_numbers[uwb_config.mode]++;
+    }
+
+    int length = mac_frame_write(frame, tx_buffer, sizeof(tx_buffer));
+    if (length < 0)
+    {
+        LOG_ERR("Failed to build frame: %d", length);
+        return -1;
+    }
+
+    if (dwt_writetxdata(length, tx_buffer, 0) != DWT_SUCCESS)
+    {
+        LOG_ERR("Failed to write tx data");
+        return -2;
+    }
+    dwt_writetxfctrl(length, 0, 1);
+    tx_length = length;
+
+    return length;
+}
+
+int uwb_calibrate_xtal(uint16_t reference, uint16_t frames)
+{
+    if (!atomic_get(&radio_running))
+    {
+        return -2;
+    }
+    if (uwb_xtal_prepare(reference, frames) != 0)
+    {
+        return -1;
+    }
+    atomic_set(&xtal_requested, 1);
+    k_sem_give(&uwb_irq_sem);
+
+    return 0;
+}
+
+int uwb_send(uint16_t dest_address, const uint8_t *payload, uint8_t length)
+{
+    uwb_tx_request_t request;
+    if (length > sizeof(request.payload))
+    {
+        LOG_ERR("Payload too long: %u", length);
+        return -1;
+    }
+
+    request.dest_address = dest_address;
+    request.length = length;
+    memcpy(request.payload, payload, length);
+    if (k_msgq_put(&uwb_tx_queue, &request, K_NO_WAIT) != 0)
+    {
+        LOG_WRN("TX queue full");
+        return -2;
+    }
+    k_sem_give(&uwb_irq_sem);
+
+    return 0;
+}
+
+static void radio_off()
+{
+    dwt_forcetrxoff();
+    tx_deadline_ms = -1;
+}
+
+static void send_queued()
+{
+    uwb_tx_request_t request;
+    // forcing the transceiver off would cancel the frame, such as an anchor's delayed sync
+    if (tx_deadline_ms >= 0 && k_uptime_get() < tx_deadline_ms)
+    {
+        return;
+    }
+    tx_deadline_ms = -1;
+    if (k_msgq_get(&uwb_tx_queue, &request, K_NO_WAIT) != 0)
+    {
+        return;
+    }
+
+    mac_frame_t frame;
+    MAC802154_FRAME_INIT(&frame, UWB_PAN_ID, uwb_config.short_address);
+    frame.dest.short_address = request.dest_address;
+    frame.payload = request.payload;
+    frame.payload_length = request.length;
+
+    dwt_forcetrxoff();
+    if (uwb_write_frame(&frame) < 0)
+    {
+        return;
+    }
+    if (dwt_starttx(DWT_START_TX_IMMEDIATE) != DWT_SUCCESS)
+    {
+        LOG_ERR("Failed to send queued frame");
+        return;
+    }
+    hold_queue(0);
+}
+
+/**
+ * @brief Hold back queued frames for the airtime of the frame just started,
+ * after its TX delay, plus a margin for the uptime resolution and the
+ * latency of the uwb thread
+ * @param delay_us: time until the DW1000 starts the frame
+ */
+static void hold_queue(uint32_t delay_us)
+{
+    const uint32_t airtime_ns = uwb_airtime_frame_ns(&uwb_phy_profile(uwb_phy_current())->config, tx_length);
+    const uint32_t hold_us = delay_us + airtime_ns / 1000;
+    tx_deadline_ms = k_uptime_get() + (hold_us + 999) / 1000 + TX_DONE_MARGIN_MS;
+}
+
+int uwb_start_tx(uint8_t mode)
+{
+    if (dwt_starttx(mode) != DWT_SUCCESS)
+    {
+        return -1;
+    }
+
+    uint32_t delay_us = 0;
+    if (mode & DWT_START_TX_DELAYED)
+    {
+        uint8_t dx_time[DX_TIME_LEN];
+        uint8_t sys_time[SYS_TIME_LEN];
+        dwt_readfromdevice(DX_TIME_ID, 0, sizeof(dx_time), dx_time);
+        dwt_readsystime(sys_time);
+        delay_us = uwb_time_ticks_to_us(uwb_time_elapsed(uwb_time_unpack(dx_time), uwb_time_unpack(sys_time)));
+    }
+    hold_queue(delay_us);
+    return 0;
+}
+
+TDOA_RAMFUNC int uwb_rx_enable(void)
+{
+    if (dwt_rxenable(DWT_START_RX_IMMEDIATE) != DWT_SUCCESS)
+    {
+        return -1;
+    }
+    port_irq_capture_rx_enabled();
+    return 0;
+}
+
+static TDOA_RAMFUNC void read_rx_diagnostics(const uint8_t *rx_time, uint32_t rx_finfo, uwb_rx_frame_t *rx)
+{
+    // the rest of dwt_readdiagnostics() comes with the timestamp and frame info
+    uint8_t rx_fqual[RX_FQUAL_LEN];
+    dwt_readfromdevice(RX_FQUAL_ID, 0, sizeof(rx_fqual), rx_fqual);
+    rx->rxpacc_nosat = dwt_read16bitoffsetreg(DRX_CONF_ID, DRX_RXPACC_NOSAT_OFFSET);
+
+    rx->diag = (dwt_rxdiag_t){
+        .firstPathAmp1 = sys_get_le16(&rx_time[RX_TIME_FP_AMPL1_OFFSET]),
+        .stdNoise = sys_get_le16(&rx_fqual[0]),
+        .firstPathAmp2 = sys_get_le16(&rx_fqual[2]),
+        .firstPathAmp3 = sys_get_le16(&rx_fqual[4]),
+        .maxGrowthCIR = sys_get_le16(&rx_fqual[6]),
+        .rxPreamCount = (rx_finfo & RX_FINFO_RXPACC_MASK) >> RX_FINFO_RXPACC_SHIFT,
+        .firstPath = sys_get_le16(&rx_time[RX_TIME_FP_INDEX_OFFSET]),
+    };
+}
+
+TDOA_RAMFUNC int uwb_read_frame(uwb_rx_frame_t *rx)
+{
+    // timestamp, first path index and first path amplitude in one burst
+    uint8_t rx_time[RX_TIME_FP_AMPL1_OFFSET + 2];
+    dwt_readfromdevice(RX_TIME_ID, 0, sizeof(rx_time), rx_time);
+    rx->rx_timestamp = uwb_time_unpack(rx_time);
+
+    const uint32_t rx_finfo = dwt_read32bitreg(RX_FINFO_ID);
+    rx->length = rx_finfo & RX_FINFO_RXFLEN_MASK;
+    if (rx->length > sizeof(rx->buffer))
+    {
+        return -1;
+    }
+
+    uint32_t edge_ticks;
+    if (port_irq_capture_edge(&edge_ticks) == 0)
+    {
+        // the RX timestamp marks the start of the PHR, the RX good interrupt fires at the end of the frame
+        correlation.device_time = uwb_time_add(rx->rx_timestamp, uwb_phy_rx_end_ticks(rx->length));
+        correlation.mcu_ticks = edge_ticks;
+        correlation.valid = true;
+    }
+
+    if (IS_ENABLED(CONFIG_TDOA_RX_DIAGNOSTICS))
+    {
+        read_rx_diagnostics(rx_time, rx_finfo, rx);
+    }
+    dwt_readrxdata(rx->buffer, rx->length, 0);
+
+    if (mac_frame_read(&rx->mac, rx->buffer, rx->length) != 0)
+    {
+        return -2;
+    }
+
+    return 0;
+}
+
+int uwb_process_frame(uwb_rx_frame_t *rx, int ret)
+{
+    rx->quality.valid = false;
+    if (ret == -1)
+    {
+        LOG_WRN("Received frame too long: %u", rx->length);
+        return ret;
+    }
+    else if (ret != 0)
+    {
+        LOG_WRN("Received malformed frame");
+        return ret;
+    }
+
+    if (IS_ENABLED(CONFIG_TDOA_RX_DIAGNOSTICS))
+    {
+        const dwt_config_t *phy = &uwb_phy_profile(uwb_phy_current())->config;
+        rx->diag.rxPreamCount = uwb_rx_quality_preamble_count(rx->diag.rxPreamCount, rx->rxpacc_nosat, phy);
+        uwb_rx_quality_compute(&rx->diag, phy->prf, &rx->quality);
+    }
+
+    if (rx->mac.src.mode == MAC802154_ADDR_MODE_SHORT)
+    {
+        uwb_stats_record(rx->mac.src.short_address, rx->mac.sequence_number, rx->rx_timestamp);
+    }
+
+    if (rx->quality.valid)
+    {
+        uwb_cir_capture(rx, &rx->diag);
+    }
+
+    return 0;
+}
+
+static void uwb_thread_main(void *, void *, void *)
+{
+    port_dw1000_lock();
+    radio_status = radio_init();
+    if (radio_status == 0)
+    {
+        uwb_events_start();
+    }
+    port_dw1000_unlock();
+    if (radio_status == 0)
+    {
+        boot_mark(BOOT_PHASE_RADIO_INITIALIZED);
+    }
+    k_sem_give(&uwb_radio_ready_sem);
+    if (radio_status != 0)
+    {
+        return;
+    }
+
+    k_sem_take(&uwb_start_sem, K_FOREVER);
+
+    port_dw1000_lock();
+    if (uwb_config.phy_profile != uwb_phy_current())
+    {
+        uwb_phy_apply(uwb_config.phy_profile);
+    }
+    dwt_settxantennadelay(uwb_config.tx_antenna_delay);
+    dwt_setrxantennadelay(uwb_config.rx_antenna_delay);
+    apply_xtal_trim();
+    algorithm->init(&uwb_config);
+    port_dw1000_unlock();
+    boot_mark(BOOT_PHASE_RADIO_STARTED);
+
+    atomic_set(&radio_running, 1);
+    uwb_loop();
+}
+
+static void uwb_loop()
 {
     while (1)
     {
-        if (k_sem_take(&uwb_irq_sem, K_MSEC(timeout_ms)) == 0)
+        int ret = k_sem_take(&uwb_irq_sem, K_MSEC(timeout_ms));
+
+        // other threads may use the DW1000 while the radio thread waits
+        port_dw1000_lock();
+        k_spinlock_key_t key = k_spin_lock(&config_changed_lock);
+        const config_fields_t changed = config_changed;
+        config_changed = (config_fields_t){0};
+        k_spin_unlock(&config_changed_lock, key);
+        if (config_fields_count(&changed) != 0)
         {
+            apply_config(&changed);
+        }
+        send_queued();
+        if (atomic_clear(&xtal_requested) != 0)
+        {
+            switch_algorithm(&uwb_xtal_algorithm);
+        }
+
+        if (ret == 0)
+        {
+            port_irq_capture_thread();
             do
             {
                 dwt_isr();
             } while (dwt_checkirq() != 0);
+            uwb_cir_flush();
         }
         else
         {
             timeout_ms = algorithm->on_event(UWB_EVENT_TIMEOUT);
         }
+
+        if (algorithm == &uwb_xtal_algorithm && !uwb_xtal_running())
+        {
+            switch_algorithm(uwb_available_algorithms[uwb_config.mode].algorithm);
+        }
+        port_dw1000_unlock();
     }
 }
 
-static void uwb_isr(void)
+static TDOA_RAMFUNC void uwb_isr(void)
 {
     k_sem_give(&uwb_irq_sem);
 }
 
-static void rx_ok_callback(const dwt_cb_data_t *cb_data)
+static TDOA_RAMFUNC void rx_ok_callback(const dwt_cb_data_t *cb_data)
 {
+    boot_mark(BOOT_PHASE_FIRST_FRAME);
     algorithm->on_event(UWB_EVENT_PACKET_RECEIVED);
 }
 
@@ -221,5 +841,14 @@ static void rx_error_callback(const dwt_cb_data_t *cb_data)
 
 static void tx_done_callback(const dwt_cb_data_t *cb_data)
 {
+    boot_mark(BOOT_PHASE_FIRST_FRAME);
+    if (tx_deadline_ms >= 0)
+    {
+        tx_deadline_ms = -1;
+        if (k_msgq_num_used_get(&uwb_tx_queue) > 0)
+        {
+            k_sem_give(&uwb_irq_sem);
+        }
+    }
     algorithm->on_event(UWB_EVENT_PACKET_SENT);
 }
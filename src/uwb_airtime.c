@@ -0,0 +1,138 @@
+/**
+ * @file uwb_airtime.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_airtime.h"
+
+#include "uwb.h"
+#include "uwb_protocol.h"
+
+// Preamble symbol durations in picoseconds
+#define PREAMBLE_SYMBOL_PS_PRF16 993590ULL
+#define PREAMBLE_SYMBOL_PS_PRF64 1017630ULL
+
+// Data symbol durations in picoseconds
+#define DATA_SYMBOL_PS_110K 8205128ULL
+#define DATA_SYMBOL_PS_850K 1025641ULL
+#define DATA_SYMBOL_PS_6M8 128205ULL
+
+// PHY header symbols, sent at 850 kbps for the 6.8 Mbps rate
+#define PHR_SYMBOLS 21
+
+static uint32_t preamble_symbols(uint8_t preamble_length)
+{
+    switch (preamble_length)
+    {
+    case DWT_PLEN_64:
+        return 64;
+    case DWT_PLEN_128:
+        return 128;
+    case DWT_PLEN_256:
+        return 256;
+    case DWT_PLEN_512:
+        return 512;
+    case DWT_PLEN_1024:
+        return 1024;
+    case DWT_PLEN_1536:
+        return 1536;
+    case DWT_PLEN_2048:
+        return 2048;
+    case DWT_PLEN_4096:
+    default:
+        return 4096;
+    }
+}
+
+static uint32_t sfd_symbols(const dwt_config_t *config)
+{
+    if (config->dataRate == DWT_BR_110K)
+    {
+        return 64;
+    }
+
+    return config->nsSFD && config->dataRate == DWT_BR_850K ? 16 : 8;
+}
+
+uint32_t uwb_airtime_data_symbol_ps(const dwt_config_t *config)
+{
+    switch (config->dataRate)
+    {
+    case DWT_BR_110K:
+        return DATA_SYMBOL_PS_110K;
+    case DWT_BR_850K:
+        return DATA_SYMBOL_PS_850K;
+    case DWT_BR_6M8:
+    default:
+        return DATA_SYMBOL_PS_6M8;
+    }
+}
+
+void uwb_airtime_frame(const dwt_config_t *config, size_t frame_length, uwb_airtime_t *airtime)
+{
+    const uint64_t preamble_symbol_ps = config->prf == DWT_PRF_16M ? PREAMBLE_SYMBOL_PS_PRF16 : PREAMBLE_SYMBOL_PS_PRF64;
+    const uint64_t phr_symbol_ps = config->dataRate == DWT_BR_110K ? DATA_SYMBOL_PS_110K : DATA_SYMBOL_PS_850K;
+
+    const uint64_t payload_ps = (uint64_t)uwb_airtime_payload_symbols(frame_length) * uwb_airtime_data_symbol_ps(config);
+
+    airtime->preamble_ns = preamble_symbols(config->txPreambLength) * preamble_symbol_ps / 1000;
+    airtime->sfd_ns = sfd_symbols(config) * preamble_symbol_ps / 1000;
+    airtime->phr_ns = PHR_SYMBOLS * phr_symbol_ps / 1000;
+    airtime->payload_ns = payload_ps / 1000;
+    airtime->total_ns = airtime->preamble_ns + airtime->sfd_ns + airtime->phr_ns + airtime->payload_ns;
+}
+
+uint32_t uwb_airtime_frame_ns(const dwt_config_t *config, size_t frame_length)
+{
+    uwb_airtime_t airtime;
+    uwb_airtime_frame(config, frame_length, &airtime);
+
+    return airtime.total_ns;
+}
+
+uint32_t uwb_airtime_slot_ns(const dwt_config_t *config)
+{
+    const size_t frame_length = UWB_FRAME_OVERHEAD + sizeof(uwb_msg_anchor_info_t) + sizeof(uwb_msg_config_ack_t);
+
+    return uwb_airtime_frame_ns(config, frame_length) + UWB_AIRTIME_SLOT_GUARD_NS;
+}
+
+uint32_t uwb_airtime_min_sync_interval_us(const dwt_config_t *config, uint32_t anchor_count)
+{
+    // interval >= anchor_count * (slot + interval * drift), solved for the interval
+    const uint64_t slots_ns = (uint64_t)anchor_count * uwb_airtime_slot_ns(config);
+    const uint64_t drift_ppm = (uint64_t)anchor_count * UWB_AIRTIME_DRIFT_PPM;
+
+    return (slots_ns * 1000 + (1000000 - drift_ppm) - 1) / (1000000 - drift_ppm);
+}
+
+int uwb_airtime_check(const dwt_config_t *config, uint32_t anchor_count, uint32_t sync_interval_ms)
+{
+    return uwb_airtime_min_sync_interval_us(config, anchor_count) <= sync_interval_ms * 1000 ? 0 : -1;
+}
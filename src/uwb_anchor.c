@@ -36,7 +36,10 @@
 #include "deca_spi.h"
 #include "mac.h"
 #include "port.h"
-#include "uwb_utils.h"
+#include "ramfunc.h"
+#include "uwb_protocol.h"
+#include "uwb_provision.h"
+#include "uwb_time.h"
 
 #include <stdlib.h>
 #include <zephyr/kernel.h>
@@ -44,70 +47,96 @@
 // #include <zephyr/random/rand32.h>
 #include <zephyr/random/random.h>
 
-LOG_MODULE_REGISTER(anchor, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(anchor, CONFIG_TDOA_ANCHOR_LOG_LEVEL);
 
 #define TX_SEND_DELAY
 
-static uwb_config_t *uwb_config;
+// Delayed TX is scheduled ~31 ms after reading the system time
+#define TX_DELAY_TICKS (200000000LL * 10)
 
-typedef struct __packed
-{
-    uint64_t sys_time;
-    uint32_t anchor_x_pos_mm;
-    uint32_t anchor_y_pos_mm;
-} anchor_sync_payload_t;
+// Send full anchor metadata every Nth superframe, plain timing syncs otherwise
+#define ANCHOR_INFO_INTERVAL 10
+
+static uwb_config_t *uwb_config;
 
 static struct
 {
     uint32_t next_tx_tick;
+    uint32_t superframe;
+    bool info_requested;
 } ctx;
 
-static uint64_t prev_sys_time = 0;
+static uint64_t prev_remote_tx_timestamp = 0;
 
-static void handle_rx_packet();
+static void handle_rx_packet(uwb_rx_frame_t *rx, int ret);
+static void handle_sync(const uwb_rx_frame_t *rx, const void *message);
+static void handle_blink(const uwb_rx_frame_t *rx, const void *message);
 static uint32_t start_next_event(uint64_t current_ticks);
 static uint32_t randomize_delay_to_next_tx();
 static int send_tx_packet();
 static void anchor_init(uwb_config_t *config);
 static uint32_t anchor_on_event(uwb_event_t event);
 
-static void handle_rx_packet()
+static const uwb_protocol_handler_t handlers[UWB_PACKET_TYPE_MAX] = {
+    [UWB_PACKET_TYPE_SYNC] = handle_sync,
+    [UWB_PACKET_TYPE_SYNC_POSITION] = handle_sync,
+    [UWB_PACKET_TYPE_ANCHOR_INFO] = handle_sync,
+    [UWB_PACKET_TYPE_BLINK] = handle_blink,
+    [UWB_PACKET_TYPE_CONFIG] = uwb_provision_handle,
+};
+
+static void handle_rx_packet(uwb_rx_frame_t *rx, int ret)
 {
-    mac_packet_t rx_packet;
-    anchor_sync_payload_t *rx_payload = (anchor_sync_payload_t *)&rx_packet.payload;
-    uint8_t ts_b[5];
-    uint64_t rx_timestamp, tx_timestamp;
-    uint32_t read_size;
+    if (uwb_process_frame(rx, ret) != 0)
+    {
+        return;
+    }
 
-    dwt_readrxtimestamp(ts_b);
-    rx_timestamp = uwb_utils_timestamp_to_u64(ts_b);
+    if (uwb_protocol_dispatch(handlers, rx) >= 0)
+    {
+        uwb_provision_receive_ack(rx);
+    }
 
-    dwt_readtxtimestamp(ts_b);
-    tx_timestamp = uwb_utils_timestamp_to_u64(ts_b);
+    // MAC802154_LOG_FRAME(&rx->mac);
+}
+
+static void handle_sync(const uwb_rx_frame_t *rx, const void *message)
+{
+    // sync, sync_position and anchor_info share the same leading layout
+    const uwb_msg_sync_t *sync = message;
+    uint8_t ts_b[5];
 
-    read_size = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFLEN_MASK;
-    if (read_size > MAC80215_PACKET_SIZE)
-        read_size = MAC80215_PACKET_SIZE;
-    dwt_readrxdata((uint8_t *)&rx_packet, read_size, 0);
+    dwt_readtxtimestamp(ts_b);
+    uint64_t tx_timestamp = uwb_time_unpack(ts_b);
+    uint64_t rx_timestamp = rx->rx_timestamp;
 
-    uint64_t sys_time = rx_payload->sys_time;
-    int64_t sys_time_delta = sys_time - prev_sys_time;
-    prev_sys_time = sys_time;
-    int64_t delta = rx_timestamp - tx_timestamp;
+    uint64_t remote_tx_timestamp = uwb_time_unpack(sync->tx_timestamp);
+    int64_t remote_tx_delta = uwb_time_elapsed(remote_tx_timestamp, prev_remote_tx_timestamp);
+    prev_remote_tx_timestamp = remote_tx_timestamp;
+    int64_t delta = uwb_time_diff(rx_timestamp, tx_timestamp);
     float delta_percent = (double)rx_timestamp / (double)tx_timestamp;
 
-    LOG_RAW("rx: %llu\ntx: %llu\ndelta: %llu\ndelta (%%): %f\nsys_time: %llu\nsys_time_delta: %lld\n\n",
+    LOG_RAW("src: %04x\nrx: %llu\ntx: %llu\ndelta: %llu\ndelta (%%): %f\nremote_tx: %llu\nremote_tx_delta: %lld\n\n",
+            rx->mac.src.short_address,
             rx_timestamp,
             tx_timestamp,
             delta,
             delta_percent,
-            sys_time,
-            sys_time_delta);
+            remote_tx_timestamp,
+            remote_tx_delta);
+}
 
-    // MAC80215_LOG_PACKET(&rx_packet);
+static void handle_blink(const uwb_rx_frame_t *rx, const void *message)
+{
+    const uwb_msg_blink_t *blink = message;
+    if (blink->flags & UWB_BLINK_FLAG_INFO_REQUEST)
+    {
+        LOG_DBG("Anchor info requested by '%04x'", rx->mac.src.short_address);
+        ctx.info_requested = true;
+    }
 }
 
-static uint32_t start_next_event(uint64_t current_ticks)
+static TDOA_RAMFUNC uint32_t start_next_event(uint64_t current_ticks)
 {
     dwt_forcetrxoff();
 
@@ -120,7 +149,7 @@ static uint32_t start_next_event(uint64_t current_ticks)
     }
     else
     {
-        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        uwb_rx_enable();
     }
 
     uint32_t delay = ctx.next_tx_tick - current_ticks;
@@ -129,7 +158,7 @@ static uint32_t start_next_event(uint64_t current_ticks)
 
 static uint32_t randomize_delay_to_next_tx()
 {
-    const uint32_t average_delay = 200;
+    const uint32_t average_delay = uwb_config->sync_interval_ms;
     const uint32_t interval = 10;
     uint32_t random = sys_rand32_get();
 
@@ -142,35 +171,59 @@ static int send_tx_packet()
 
     uint8_t ts_b[5];
     dwt_readsystime(ts_b);
-    uint64_t start = uwb_utils_timestamp_to_u64(ts_b);
+    uint64_t start = uwb_time_unpack(ts_b);
 
-    uint32_t delay = (start + (200000000 * 10)) >> 8;
+    uint32_t delay = uwb_time_add(start, TX_DELAY_TICKS) >> 8;
     dwt_setdelayedtrxtime(delay);
 
-    mac_packet_t tx_packet;
-    anchor_sync_payload_t *tx_payload = (anchor_sync_payload_t *)&tx_packet.payload;
-    MAC80215_PACKET_INIT(&tx_packet, MAC802154_TYPE_DATA);
-    memcpy(tx_packet.src_address, uwb_config->address, 8);
-    tx_payload->anchor_x_pos_mm = uwb_config->anchor_x_pos_mm;
-    tx_payload->anchor_y_pos_mm = uwb_config->anchor_y_pos_mm;
+    // The delayed TX time ignores the low 9 bits, the antenna delay is added by the DW1000
+    uint64_t tx_timestamp = uwb_time_add((uint64_t)(delay & 0xFFFFFFFEUL) << 8, uwb_config->tx_antenna_delay);
+
+    union {
+        uwb_msg_sync_t sync;
+        uwb_msg_anchor_info_t info;
+        uint8_t raw[sizeof(uwb_msg_anchor_info_t) + sizeof(uwb_msg_config_ack_t)];
+    } tx_payload;
+    mac_frame_t tx_frame;
+    MAC802154_FRAME_INIT(&tx_frame, UWB_PAN_ID, uwb_config->short_address);
+    tx_frame.payload = (uint8_t *)&tx_payload;
 
-    if (dwt_writetxdata(sizeof(tx_packet), (uint8_t *)&tx_packet, 0) != DWT_SUCCESS)
+    if (ctx.info_requested || ctx.superframe % ANCHOR_INFO_INTERVAL == 0)
+    {
+        UWB_MESSAGE_INIT(&tx_payload.info, UWB_PACKET_TYPE_ANCHOR_INFO);
+        uwb_time_pack(tx_timestamp, tx_payload.info.tx_timestamp);
+        tx_payload.info.x_pos_mm = uwb_config->anchor_x_pos_mm;
+        tx_payload.info.y_pos_mm = uwb_config->anchor_y_pos_mm;
+        tx_payload.info.phy_profile = uwb_config->phy_profile;
+        tx_payload.info.clock_quality = UWB_CLOCK_QUALITY_UNKNOWN;
+        tx_frame.payload_length = sizeof(tx_payload.info);
+        ctx.info_requested = false;
+    }
+    else
+    {
+        UWB_MESSAGE_INIT(&tx_payload.sync, UWB_PACKET_TYPE_SYNC);
+        uwb_time_pack(tx_timestamp, tx_payload.sync.tx_timestamp);
+        tx_frame.payload_length = sizeof(tx_payload.sync);
+    }
+    tx_frame.payload_length += uwb_provision_write_ack(&tx_payload.raw[tx_frame.payload_length],
+                                                       sizeof(tx_payload) - tx_frame.payload_length);
+    ++ctx.superframe;
+
+    if (uwb_write_frame(&tx_frame) < 0)
     {
-        LOG_ERR("Failed to write tx data");
         return -1;
     }
-    dwt_writetxfctrl(sizeof(tx_packet), 0, 1);
 
-    if (dwt_starttx(DWT_START_TX_DELAYED) != DWT_SUCCESS)
+    if (uwb_start_tx(DWT_START_TX_DELAYED) != 0)
     {
         LOG_ERR("Failed to send tx packet");
         return -2;
     }
 
     dwt_readsystime(ts_b);
-    uint64_t end = uwb_utils_timestamp_to_u64(ts_b);
+    uint64_t end = uwb_time_unpack(ts_b);
 
-    uint64_t send_time = end - start;
+    uint64_t send_time = uwb_time_elapsed(end, start);
 
     LOG_DBG("Send time: %llu", send_time);
 
@@ -183,17 +236,24 @@ static void anchor_init(uwb_config_t *config)
     uwb_config = config;
 
     ctx.next_tx_tick = 0;
+    ctx.superframe = 0;
+    ctx.info_requested = false;
 }
 
-static uint32_t anchor_on_event(uwb_event_t event)
+static TDOA_RAMFUNC uint32_t anchor_on_event(uwb_event_t event)
 {
-    if (event == UWB_EVENT_PACKET_RECEIVED)
+    if (event != UWB_EVENT_PACKET_RECEIVED)
     {
-        handle_rx_packet();
+        return start_next_event(k_uptime_ticks());
     }
 
-    int64_t now = k_uptime_ticks();
-    return start_next_event(now);
+    // the frame is read from RAM and handled from flash once the radio listens or sends again
+    uwb_rx_frame_t rx;
+    const int ret = uwb_read_frame(&rx);
+    const uint32_t timeout = start_next_event(k_uptime_ticks());
+    handle_rx_packet(&rx, ret);
+
+    return timeout;
 }
 
 uwb_algorithm_t uwb_anchor_algorithm = {
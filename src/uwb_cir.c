@@ -0,0 +1,211 @@
+/**
+ * @file uwb_cir.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_cir.h"
+
+#include "deca_regs.h"
+#include "telemetry.h"
+#include "uwb_phy.h"
+#include "uwb_time.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+// Accumulator length in taps
+#define ACC_TAPS_PRF16 992
+#define ACC_TAPS_PRF64 1016
+
+// readfromspi() stages a transfer in 255 byte buffers, which also hold a
+// header of up to 3 bytes and the dummy byte of an accumulator read
+#define ACC_READ_CHUNK 240
+
+#define SIZE_META 31
+#define SIZE_PAYLOAD(taps) (SIZE_META + (taps) * UWB_CIR_TAP_SIZE)
+
+// Guards the settings and the statistics
+static struct k_spinlock cir_lock;
+static uwb_cir_status_t cir;
+static uint16_t skipped;
+
+// Record of the selected frame, its window is read by uwb_cir_flush()
+static uint8_t record[TELEMETRY_RECORD_SIZE(SIZE_PAYLOAD(CONFIG_TDOA_CIR_TAPS_MAX))];
+static struct
+{
+    bool pending;
+    uint16_t first_tap;
+    uint16_t taps;
+} window;
+
+int uwb_cir_start(uint16_t source, uint16_t taps, uint16_t every)
+{
+    if (taps == 0 || taps > CONFIG_TDOA_CIR_TAPS_MAX || every == 0)
+    {
+        return -1;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&cir_lock);
+    cir.source = source;
+    cir.taps = taps;
+    cir.every = every;
+    cir.enabled = true;
+    skipped = 0;
+    k_spin_unlock(&cir_lock, key);
+
+    return 0;
+}
+
+void uwb_cir_stop()
+{
+    k_spinlock_key_t key = k_spin_lock(&cir_lock);
+    cir.enabled = false;
+    k_spin_unlock(&cir_lock, key);
+}
+
+void uwb_cir_status(uwb_cir_status_t *status)
+{
+    k_spinlock_key_t key = k_spin_lock(&cir_lock);
+    *status = cir;
+    k_spin_unlock(&cir_lock, key);
+}
+
+/**
+ * @brief Decide whether a frame is captured and get the window length
+ * @return window length in taps, 0 if the frame is not captured
+ */
+static uint16_t select_frame(uint16_t source)
+{
+    uint16_t taps = 0;
+
+    if (!telemetry_streaming())
+    {
+        return 0;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&cir_lock);
+    if (cir.enabled && (cir.source == UWB_CIR_SOURCE_ANY || cir.source == source))
+    {
+        if (++skipped >= cir.every)
+        {
+            skipped = 0;
+            taps = cir.taps;
+        }
+    }
+    k_spin_unlock(&cir_lock, key);
+
+    return taps;
+}
+
+static void count_record(int ret)
+{
+    k_spinlock_key_t key = k_spin_lock(&cir_lock);
+    if (ret == 0)
+    {
+        ++cir.captured;
+    }
+    else if (ret == -2)
+    {
+        ++cir.overwritten;
+    }
+    else
+    {
+        ++cir.dropped;
+    }
+    k_spin_unlock(&cir_lock, key);
+}
+
+void uwb_cir_capture(const uwb_rx_frame_t *rx, const dwt_rxdiag_t *diag)
+{
+    const uint16_t source = rx->mac.src.mode == MAC802154_ADDR_MODE_SHORT ? rx->mac.src.short_address : UWB_CIR_SOURCE_ANY;
+    const uint16_t taps = select_frame(source);
+    if (taps == 0)
+    {
+        return;
+    }
+
+    // start a quarter of the window before the first path to include the noise floor
+    const uint16_t acc_taps = uwb_phy_profile(uwb_phy_current())->config.prf == DWT_PRF_16M ? ACC_TAPS_PRF16 : ACC_TAPS_PRF64;
+    const uint16_t first_path_tap = diag->firstPath >> 6;
+    uint16_t first_tap = first_path_tap > taps / 4 ? first_path_tap - taps / 4 : 0;
+    if (first_tap > acc_taps - taps)
+    {
+        first_tap = acc_taps - taps;
+    }
+
+    uint8_t *meta = &record[TELEMETRY_HEADER_SIZE];
+    sys_put_le16(source, &meta[0]);
+    meta[2] = rx->mac.sequence_number;
+    uwb_time_pack(rx->rx_timestamp, &meta[3]);
+    sys_put_le16(diag->firstPath, &meta[8]);
+    sys_put_le16(diag->firstPathAmp1, &meta[10]);
+    sys_put_le16(diag->firstPathAmp2, &meta[12]);
+    sys_put_le16(diag->firstPathAmp3, &meta[14]);
+    sys_put_le16(diag->stdNoise, &meta[16]);
+    sys_put_le16(diag->maxGrowthCIR, &meta[18]);
+    sys_put_le16(diag->rxPreamCount, &meta[20]);
+    sys_put_le16(rx->quality.first_path_power, &meta[22]);
+    sys_put_le16(rx->quality.rx_power, &meta[24]);
+    meta[26] = rx->quality.nlos_score;
+    sys_put_le16(first_tap, &meta[27]);
+    sys_put_le16(taps, &meta[29]);
+
+    window.first_tap = first_tap;
+    window.taps = taps;
+    window.pending = true;
+}
+
+void uwb_cir_flush()
+{
+    if (!window.pending)
+    {
+        return;
+    }
+    window.pending = false;
+
+    uint8_t *data = &record[TELEMETRY_HEADER_SIZE + SIZE_META];
+    const size_t size = window.taps * UWB_CIR_TAP_SIZE;
+    for (size_t pos = 0; pos < size; pos += ACC_READ_CHUNK)
+    {
+        const size_t chunk = MIN(size - pos, ACC_READ_CHUNK);
+        // the read starts with a dummy byte, let it land on the byte before the chunk and restore that
+        const uint8_t saved = data[pos - 1];
+        dwt_readaccdata(&data[pos - 1], chunk + 1, window.first_tap * UWB_CIR_TAP_SIZE + pos);
+        data[pos - 1] = saved;
+    }
+
+    // a preamble detected since the receiver was re-enabled overwrites the accumulator
+    if (dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_RXPRD)
+    {
+        count_record(-2);
+        return;
+    }
+
+    count_record(telemetry_send(TELEMETRY_RECORD_CIR, record, SIZE_PAYLOAD(window.taps)));
+}
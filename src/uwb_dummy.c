@@ -33,7 +33,7 @@
 
 #include <zephyr/logging/log.h>
 
-LOG_MODULE_REGISTER(dummy, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(dummy, CONFIG_TDOA_DUMMY_LOG_LEVEL);
 
 static void dummy_init(uwb_config_t *config);
 static uint32_t dummy_on_event(uwb_event_t event);
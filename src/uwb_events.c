@@ -0,0 +1,196 @@
+/**
+ * @file uwb_events.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_events.h"
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "telemetry.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(events, CONFIG_TDOA_EVENTS_LOG_LEVEL);
+
+// The counters are 12 bit, they are cleared long before they can saturate
+#define COUNTER_MASK 0xFFF
+#define COUNTER_CLEAR_THRESHOLD 0x800
+// Retry delay when the radio thread holds the DW1000
+#define SAMPLE_RETRY_MS 10
+
+#define SIZE_PAYLOAD (2 * sizeof(uint32_t) + UWB_EVC_MAX * sizeof(uint16_t))
+
+static void sample_counters(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_counters);
+
+static const char *const names[UWB_EVC_MAX] = {
+    [UWB_EVC_PHR_ERROR] = "phr_error",
+    [UWB_EVC_RS_SYNC_LOSS] = "rs_sync_loss",
+    [UWB_EVC_FCS_GOOD] = "fcs_good",
+    [UWB_EVC_FCS_ERROR] = "fcs_error",
+    [UWB_EVC_FILTER_REJECT] = "filter_reject",
+    [UWB_EVC_OVERRUN] = "overrun",
+    [UWB_EVC_SFD_TIMEOUT] = "sfd_timeout",
+    [UWB_EVC_PREAMBLE_TIMEOUT] = "preamble_timeout",
+    [UWB_EVC_FRAME_WAIT_TIMEOUT] = "frame_wait_timeout",
+    [UWB_EVC_TX_FRAME] = "tx_frame",
+    [UWB_EVC_HALF_PERIOD_WARNING] = "half_period_warn",
+    [UWB_EVC_POWER_UP_WARNING] = "power_up_warn",
+};
+
+// Guards the published counters
+static struct k_spinlock events_lock;
+static uwb_events_t events;
+
+// Only used by the sample work
+static uint16_t previous[UWB_EVC_MAX];
+static int64_t previous_ms;
+
+void uwb_events_start()
+{
+    dwt_configeventcounters(1);
+    previous_ms = k_uptime_get();
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_TDOA_EVENT_COUNTERS_PERIOD_MS));
+}
+
+int uwb_events_read(uwb_events_t *copy)
+{
+    k_spinlock_key_t key = k_spin_lock(&events_lock);
+    *copy = events;
+    k_spin_unlock(&events_lock, key);
+
+    return copy->samples > 0 ? 0 : -1;
+}
+
+void uwb_events_reset()
+{
+    k_spinlock_key_t key = k_spin_lock(&events_lock);
+    memset(events.total, 0, sizeof(events.total));
+    k_spin_unlock(&events_lock, key);
+}
+
+const char *uwb_events_name(uwb_evc_t counter)
+{
+    if (counter >= UWB_EVC_MAX)
+    {
+        return "";
+    }
+
+    return names[counter];
+}
+
+static void send_telemetry(const uint16_t *counts, uint32_t period_ms)
+{
+    uint8_t record[TELEMETRY_RECORD_SIZE(SIZE_PAYLOAD)];
+    uint8_t *payload = &record[TELEMETRY_HEADER_SIZE];
+
+    sys_put_le32(k_uptime_get_32(), &payload[0]);
+    sys_put_le32(period_ms, &payload[4]);
+    for (int i = 0; i < UWB_EVC_MAX; ++i)
+    {
+        sys_put_le16(counts[i], &payload[8 + 2 * i]);
+    }
+
+    telemetry_send(TELEMETRY_RECORD_EVENTS, record, SIZE_PAYLOAD);
+}
+
+static void sample_counters(struct k_work *work)
+{
+    // never make the radio thread wait for a sample
+    if (port_dw1000_trylock() != 0)
+    {
+        k_work_schedule(&sample_work, K_MSEC(SAMPLE_RETRY_MS));
+        return;
+    }
+
+    dwt_deviceentcnts_t counters;
+    dwt_readeventcounters(&counters);
+    const int64_t now_ms = k_uptime_get();
+
+    const uint16_t current[UWB_EVC_MAX] = {
+        [UWB_EVC_PHR_ERROR] = counters.PHE,
+        [UWB_EVC_RS_SYNC_LOSS] = counters.RSL,
+        [UWB_EVC_FCS_GOOD] = counters.CRCG,
+        [UWB_EVC_FCS_ERROR] = counters.CRCB,
+        [UWB_EVC_FILTER_REJECT] = counters.ARFE,
+        [UWB_EVC_OVERRUN] = counters.OVER,
+        [UWB_EVC_SFD_TIMEOUT] = counters.SFDTO,
+        [UWB_EVC_PREAMBLE_TIMEOUT] = counters.PTO,
+        [UWB_EVC_FRAME_WAIT_TIMEOUT] = counters.RTO,
+        [UWB_EVC_TX_FRAME] = counters.TXF,
+        [UWB_EVC_HALF_PERIOD_WARNING] = counters.HPW,
+        [UWB_EVC_POWER_UP_WARNING] = counters.TXW,
+    };
+
+    bool clear = false;
+    for (int i = 0; i < UWB_EVC_MAX; ++i)
+    {
+        clear |= current[i] >= COUNTER_CLEAR_THRESHOLD;
+    }
+    if (clear)
+    {
+        // events between the read and the clear are lost
+        dwt_configeventcounters(1);
+    }
+    port_dw1000_unlock();
+
+    uint16_t counts[UWB_EVC_MAX];
+    for (int i = 0; i < UWB_EVC_MAX; ++i)
+    {
+        counts[i] = (current[i] - previous[i]) & COUNTER_MASK;
+        previous[i] = clear ? 0 : current[i];
+    }
+    const uint32_t period_ms = now_ms - previous_ms;
+    previous_ms = now_ms;
+
+    k_spinlock_key_t key = k_spin_lock(&events_lock);
+    for (int i = 0; i < UWB_EVC_MAX; ++i)
+    {
+        events.total[i] += counts[i];
+        events.last[i] = counts[i];
+        events.rate_x100[i] = period_ms > 0 ? (uint64_t)counts[i] * 100000 / period_ms : 0;
+    }
+    events.period_ms = period_ms;
+    ++events.samples;
+    k_spin_unlock(&events_lock, key);
+
+    if (counts[UWB_EVC_OVERRUN] > 0)
+    {
+        LOG_WRN("%u receiver overruns in %u ms", counts[UWB_EVC_OVERRUN], period_ms);
+    }
+
+    send_telemetry(counts, period_ms);
+
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_TDOA_EVENT_COUNTERS_PERIOD_MS));
+}
@@ -0,0 +1,174 @@
+/**
+ * @file uwb_phy.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_phy.h"
+
+#include "config.h"
+#include "deca_regs.h"
+#include "ramfunc.h"
+#include "uwb_airtime.h"
+#include "uwb_range_bias.h"
+#include "uwb_time.h"
+
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(phy, CONFIG_TDOA_PHY_LOG_LEVEL);
+
+_Static_assert(CONFIG_PHY_PROFILE_DEFAULT == UWB_PHY_PROFILE_DEFAULT, "Default config PHY profile mismatch");
+_Static_assert(CONFIG_PHY_PROFILE_LAST == UWB_PHY_PROFILE_MAX - 1, "Config PHY profile range mismatch");
+
+// Reference TX power for channel 5 at 64 MHz PRF (DW1000 user manual, table 20)
+#define TX_POWER_CH5_PRF64_SMART 0x25456585UL
+#define TX_POWER_CH5_PRF64_MANUAL 0x85858585UL
+
+static const uwb_phy_profile_desc_t profiles[UWB_PHY_PROFILE_MAX] = {
+    [UWB_PHY_PROFILE_SHORT] = {
+        .name = "short",
+        .description = "64 symbol preamble, 6.8 Mbps. Shortest airtime for small rooms",
+        .config = {
+            5,               /* Channel number. */
+            DWT_PRF_64M,     /* Pulse repetition frequency. */
+            DWT_PLEN_64,     /* Preamble length. Used in TX only. */
+            DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+            9,               /* TX preamble code. Used in TX only. */
+            9,               /* RX preamble code. Used in RX only. */
+            0,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+            DWT_BR_6M8,      /* Data rate. */
+            DWT_PHRMODE_STD, /* PHY header mode. */
+            (65)             /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+        },
+        .tx = {TC_PGDELAY_CH5, TX_POWER_CH5_PRF64_SMART},
+        .smart_tx_power = true,
+    },
+    [UWB_PHY_PROFILE_DEFAULT] = {
+        .name = "default",
+        .description = "128 symbol preamble, 6.8 Mbps",
+        .config = {
+            5,               /* Channel number. */
+            DWT_PRF_64M,     /* Pulse repetition frequency. */
+            DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+            DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+            9,               /* TX preamble code. Used in TX only. */
+            9,               /* RX preamble code. Used in RX only. */
+            1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+            DWT_BR_6M8,      /* Data rate. */
+            DWT_PHRMODE_EXT, /* PHY header mode. */
+            (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+        },
+        .tx = {TC_PGDELAY_CH5, TX_POWER_CH5_PRF64_SMART},
+        .smart_tx_power = true,
+    },
+    [UWB_PHY_PROFILE_LONG] = {
+        .name = "long",
+        .description = "1024 symbol preamble, 110 kbps. Longest range for large halls",
+        .config = {
+            5,               /* Channel number. */
+            DWT_PRF_64M,     /* Pulse repetition frequency. */
+            DWT_PLEN_1024,   /* Preamble length. Used in TX only. */
+            DWT_PAC32,       /* Preamble acquisition chunk size. Used in RX only. */
+            9,               /* TX preamble code. Used in TX only. */
+            9,               /* RX preamble code. Used in RX only. */
+            1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+            DWT_BR_110K,     /* Data rate. */
+            DWT_PHRMODE_STD, /* PHY header mode. */
+            (1057)           /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+        },
+        // Smart TX power only applies to short 6.8 Mbps frames
+        .tx = {TC_PGDELAY_CH5, TX_POWER_CH5_PRF64_MANUAL},
+        .smart_tx_power = false,
+    },
+};
+
+static uwb_phy_profile_t current = UWB_PHY_PROFILE_DEFAULT;
+// PHY header and data symbol durations of the applied profile in DW1000 ticks
+static uint32_t phr_ticks;
+static uint32_t data_symbol_ticks;
+
+const uwb_phy_profile_desc_t *uwb_phy_profile(uwb_phy_profile_t profile)
+{
+    if (profile >= UWB_PHY_PROFILE_MAX)
+    {
+        return NULL;
+    }
+
+    return &profiles[profile];
+}
+
+int uwb_phy_profile_by_name(const char *name)
+{
+    for (int profile = 0; profile < UWB_PHY_PROFILE_MAX; ++profile)
+    {
+        if (strcmp(profiles[profile].name, name) == 0)
+        {
+            return profile;
+        }
+    }
+
+    return -1;
+}
+
+uwb_phy_profile_t uwb_phy_current()
+{
+    return current;
+}
+
+int uwb_phy_apply(uwb_phy_profile_t profile)
+{
+    if (profile >= UWB_PHY_PROFILE_MAX)
+    {
+        LOG_ERR("Unknown PHY profile: %u", profile);
+        return -1;
+    }
+
+    const uwb_phy_profile_desc_t *desc = &profiles[profile];
+    dwt_configure((dwt_config_t *)&desc->config);
+    dwt_setsmarttxpower(desc->smart_tx_power);
+    dwt_configuretxrf((dwt_txconfig_t *)&desc->tx);
+    uwb_range_bias_init(&desc->config);
+    current = profile;
+
+    // rounded to whole ticks, the 6.8 Mbps, 850 kbps and 110 kbps symbols are 2^13, 2^16 and 2^19 ticks
+    const int64_t half_tick_ps = UWB_TIME_PS_NUM / UWB_TIME_PS_DEN / 2;
+    uwb_airtime_t airtime;
+    uwb_airtime_frame(&desc->config, 0, &airtime);
+    phr_ticks = uwb_time_ps_to_ticks((int64_t)airtime.phr_ns * 1000 + half_tick_ps);
+    data_symbol_ticks = uwb_time_ps_to_ticks(uwb_airtime_data_symbol_ps(&desc->config) + half_tick_ps);
+
+    LOG_INF("Applied PHY profile '%s'", desc->name);
+
+    return 0;
+}
+
+TDOA_RAMFUNC uint32_t uwb_phy_rx_end_ticks(size_t frame_length)
+{
+    return phr_ticks + uwb_airtime_payload_symbols(frame_length) * data_symbol_ticks;
+}
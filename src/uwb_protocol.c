@@ -0,0 +1,135 @@
+/**
+ * @file uwb_protocol.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_protocol.h"
+
+#include "ramfunc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(protocol, CONFIG_TDOA_PROTOCOL_LOG_LEVEL);
+
+static const struct
+{
+    uint8_t size;
+    const char *name;
+} messages[] = {
+    [UWB_PACKET_TYPE_SYNC] = {sizeof(uwb_msg_sync_t), "sync"},
+    [UWB_PACKET_TYPE_SYNC_POSITION] = {sizeof(uwb_msg_sync_position_t), "sync_position"},
+    [UWB_PACKET_TYPE_BLINK] = {sizeof(uwb_msg_blink_t), "blink"},
+    [UWB_PACKET_TYPE_TIMESTAMP_REPORT] = {sizeof(uwb_msg_timestamp_report_t), "timestamp_report"},
+    [UWB_PACKET_TYPE_CONFIG] = {sizeof(uwb_msg_config_t), "config"},
+    [UWB_PACKET_TYPE_CLOCK_MODEL] = {sizeof(uwb_msg_clock_model_t), "clock_model"},
+    [UWB_PACKET_TYPE_ANCHOR_INFO] = {sizeof(uwb_msg_anchor_info_t), "anchor_info"},
+};
+
+_Static_assert(ARRAY_SIZE(messages) == UWB_PACKET_TYPE_MAX, "Missing uwb message description");
+
+size_t uwb_protocol_message_size(uwb_packet_type_t type)
+{
+    if (type >= UWB_PACKET_TYPE_MAX)
+    {
+        return 0;
+    }
+
+    return messages[type].size;
+}
+
+const char *uwb_protocol_message_name(uwb_packet_type_t type)
+{
+    if (type >= UWB_PACKET_TYPE_MAX)
+    {
+        return "UNKNOWN";
+    }
+
+    return messages[type].name;
+}
+
+TDOA_RAMFUNC int uwb_protocol_dispatch(const uwb_protocol_handler_t handlers[UWB_PACKET_TYPE_MAX], const uwb_rx_frame_t *rx)
+{
+    if (rx->mac.payload_length < sizeof(uwb_msg_header_t))
+    {
+        LOG_WRN("Empty payload from '%04x'", rx->mac.src.short_address);
+        return -1;
+    }
+
+    const uwb_msg_header_t *header = (const uwb_msg_header_t *)rx->mac.payload;
+    if (header->version != UWB_PROTOCOL_VERSION)
+    {
+        LOG_WRN("Protocol version mismatch from '%04x'. Got '%u', expected '%u'",
+                rx->mac.src.short_address, header->version, UWB_PROTOCOL_VERSION);
+        return -2;
+    }
+    if (header->type >= UWB_PACKET_TYPE_MAX)
+    {
+        LOG_WRN("Unknown message type '%u' from '%04x'", header->type, rx->mac.src.short_address);
+        return -3;
+    }
+    if (rx->mac.payload_length < messages[header->type].size)
+    {
+        LOG_WRN("Short '%s' message from '%04x'. Got '%u', expected '%u'",
+                messages[header->type].name, rx->mac.src.short_address,
+                rx->mac.payload_length, messages[header->type].size);
+        return -4;
+    }
+
+    if (handlers[header->type] == NULL)
+    {
+        return 1;
+    }
+
+    handlers[header->type](rx, header);
+
+    return 0;
+}
+
+const uwb_msg_config_ack_t *uwb_protocol_config_ack(const uwb_rx_frame_t *rx)
+{
+    const uwb_msg_header_t *header = (const uwb_msg_header_t *)rx->mac.payload;
+    switch (header->type)
+    {
+    case UWB_PACKET_TYPE_SYNC:
+    case UWB_PACKET_TYPE_SYNC_POSITION:
+    case UWB_PACKET_TYPE_ANCHOR_INFO:
+    case UWB_PACKET_TYPE_BLINK:
+        break;
+    default:
+        return NULL;
+    }
+
+    const size_t size = messages[header->type].size;
+    if (rx->mac.payload_length < size + sizeof(uwb_msg_config_ack_t))
+    {
+        return NULL;
+    }
+
+    return (const uwb_msg_config_ack_t *)&rx->mac.payload[size];
+}
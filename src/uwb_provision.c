@@ -0,0 +1,272 @@
+/**
+ * @file uwb_provision.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_provision.h"
+
+#include "mac.h"
+#include "uwb_protocol.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+
+LOG_MODULE_REGISTER(provision, CONFIG_TDOA_PROVISION_LOG_LEVEL);
+
+#define CRC_SIZE sizeof(uint16_t)
+#define TLV_SIZE_MAX (UWB_PAYLOAD_SIZE_MAX - sizeof(uwb_msg_config_t) - CRC_SIZE)
+
+// Updates are repeated until a unicast target acknowledges them
+#define SEND_REPEAT_COUNT 5
+#define SEND_REPEAT_INTERVAL_MS 100
+
+// Identifies repeats of the last update, the CRC tells a rebooted sender's reused sequence apart
+static struct
+{
+    uint16_t source_address;
+    uint16_t sequence;
+    uint16_t crc;
+    int8_t status;
+    bool valid;
+} last_update;
+
+// Owned by the work queue while applying is set
+static struct
+{
+    uint16_t sequence;
+    uint8_t tlv_length;
+    uint8_t tlv[TLV_SIZE_MAX];
+    bool applying;
+} update;
+
+static struct
+{
+    uwb_msg_config_ack_t message;
+    bool pending;
+} ack;
+
+static struct
+{
+    uint16_t target_address;
+    uint16_t sequence;
+    uint8_t length;
+    uint8_t repeats_left;
+    uint8_t payload[UWB_PAYLOAD_SIZE_MAX];
+} outgoing;
+
+// Guards last_update, update.applying and ack
+static struct k_spinlock lock;
+
+static uint16_t message_crc(const uwb_msg_config_t *message);
+static void apply_update(struct k_work *work);
+static void set_ack(uint16_t sequence, int8_t status);
+static void send_outgoing(struct k_work *work);
+
+K_WORK_DEFINE(apply_work, apply_update);
+K_WORK_DELAYABLE_DEFINE(send_work, send_outgoing);
+
+void uwb_provision_handle(const uwb_rx_frame_t *rx, const void *message)
+{
+    const uwb_msg_config_t *config = message;
+    if (config->target_address != MAC802154_BROADCAST_ADDRESS && config->target_address != uwb_short_address())
+    {
+        return;
+    }
+
+    if (rx->mac.payload_length < sizeof(*config) + config->tlv_length + CRC_SIZE)
+    {
+        LOG_WRN("Truncated config update from '%04x'", rx->mac.src.short_address);
+        return;
+    }
+
+    uint16_t crc;
+    memcpy(&crc, &config->tlv[config->tlv_length], CRC_SIZE);
+    if (crc != message_crc(config))
+    {
+        LOG_WRN("Config update from '%04x' failed CRC check", rx->mac.src.short_address);
+        return;
+    }
+
+    if (config->tlv_length > sizeof(update.tlv))
+    {
+        LOG_WRN("Config update %u from '%04x' too large: %u bytes",
+                config->sequence, rx->mac.src.short_address, config->tlv_length);
+        set_ack(config->sequence, UWB_PROVISION_STATUS_INVALID);
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    // Senders repeat updates until acknowledged, only acknowledge them again
+    const bool repeat = last_update.valid &&
+                        last_update.source_address == rx->mac.src.short_address &&
+                        last_update.sequence == config->sequence &&
+                        last_update.crc == crc;
+    const bool applying = update.applying;
+    if (!repeat && !applying)
+    {
+        last_update.source_address = rx->mac.src.short_address;
+        last_update.sequence = config->sequence;
+        last_update.crc = crc;
+        last_update.valid = false;
+        update.applying = true;
+    }
+    const int8_t status = last_update.status;
+    k_spin_unlock(&lock, key);
+
+    if (repeat)
+    {
+        set_ack(config->sequence, status);
+        return;
+    }
+    if (applying)
+    {
+        LOG_WRN("Config update %u dropped, previous update still applying", config->sequence);
+        return;
+    }
+
+    update.sequence = config->sequence;
+    update.tlv_length = config->tlv_length;
+    memcpy(update.tlv, config->tlv, update.tlv_length);
+    k_work_submit(&apply_work);
+}
+
+static void apply_update(struct k_work *work)
+{
+    const uint16_t sequence = update.sequence;
+    int8_t status = config_apply_tlv(update.tlv, update.tlv_length);
+    LOG_INF("Config update %u applied: %d", sequence, status);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    last_update.status = status;
+    last_update.valid = true;
+    update.applying = false;
+    k_spin_unlock(&lock, key);
+
+    set_ack(sequence, status);
+}
+
+static void set_ack(uint16_t sequence, int8_t status)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    ack.message.sequence = sequence;
+    ack.message.status = status;
+    ack.pending = true;
+    k_spin_unlock(&lock, key);
+}
+
+bool uwb_provision_ack_pending()
+{
+    return ack.pending;
+}
+
+size_t uwb_provision_write_ack(uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (ack.pending && size >= sizeof(ack.message))
+    {
+        memcpy(buffer, &ack.message, sizeof(ack.message));
+        ack.pending = false;
+        written = sizeof(ack.message);
+    }
+    k_spin_unlock(&lock, key);
+
+    return written;
+}
+
+void uwb_provision_receive_ack(const uwb_rx_frame_t *rx)
+{
+    const uwb_msg_config_ack_t *received = uwb_protocol_config_ack(rx);
+    if (received == NULL)
+    {
+        return;
+    }
+
+    LOG_INF("Config update %u acknowledged by '%04x': %d",
+            received->sequence, rx->mac.src.short_address, received->status);
+
+    if (received->sequence == outgoing.sequence && rx->mac.src.short_address == outgoing.target_address)
+    {
+        k_work_cancel_delayable(&send_work);
+    }
+}
+
+int uwb_provision_send(uint16_t target_address, config_field_t field, const void *value, uint8_t size)
+{
+    if (2 + size > TLV_SIZE_MAX)
+    {
+        return -1;
+    }
+    if (k_work_delayable_busy_get(&send_work) != 0)
+    {
+        LOG_WRN("Previous update %u is still being sent", outgoing.sequence);
+        return -2;
+    }
+
+    uwb_msg_config_t *message = (uwb_msg_config_t *)outgoing.payload;
+    UWB_MESSAGE_INIT(message, UWB_PACKET_TYPE_CONFIG);
+    message->target_address = target_address;
+    message->sequence = outgoing.sequence + 1;
+    message->tlv_length = 2 + size;
+    message->tlv[0] = field;
+    message->tlv[1] = size;
+    memcpy(&message->tlv[2], value, size);
+
+    uint16_t crc = message_crc(message);
+    memcpy(&message->tlv[message->tlv_length], &crc, CRC_SIZE);
+
+    outgoing.target_address = target_address;
+    outgoing.sequence = message->sequence;
+    outgoing.length = sizeof(*message) + message->tlv_length + CRC_SIZE;
+    outgoing.repeats_left = SEND_REPEAT_COUNT;
+    k_work_schedule(&send_work, K_NO_WAIT);
+
+    return outgoing.sequence;
+}
+
+static void send_outgoing(struct k_work *work)
+{
+    if (uwb_send(outgoing.target_address, outgoing.payload, outgoing.length) != 0)
+    {
+        LOG_WRN("Failed to queue config update %u", outgoing.sequence);
+    }
+
+    if (--outgoing.repeats_left > 0)
+    {
+        k_work_schedule(&send_work, K_MSEC(SEND_REPEAT_INTERVAL_MS));
+    }
+}
+
+static uint16_t message_crc(const uwb_msg_config_t *message)
+{
+    const uint8_t *start = (const uint8_t *)&message->target_address;
+    return crc16_ccitt(0xFFFF, start, message->tlv + message->tlv_length - start);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file uwb_range_bias.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_range_bias.h"
+
+#include "deca_range_tables.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(range_bias, CONFIG_TDOA_PHY_LOG_LEVEL);
+
+// Bias in centimeters for each 25 cm step of measured range
+static int8_t bias_cm[DWT_RANGE_BIAS_STEPS];
+
+// Configuration selected by uwb_range_bias_init(), built into bias_cm on the next lookup
+static struct
+{
+    uint8_t chan;
+    uint8_t prf;
+    bool stale;
+} selected;
+
+int uwb_range_bias_init(const dwt_config_t *config)
+{
+    // the channels of the narrow and wide band driver tables
+    switch (config->chan)
+    {
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+    case 7:
+        break;
+    default:
+        LOG_ERR("No range bias table for channel %u", config->chan);
+        return -1;
+    }
+
+    selected.chan = config->chan;
+    selected.prf = config->prf;
+    selected.stale = true;
+
+    return 0;
+}
+
+static void build_table()
+{
+    selected.stale = false;
+    if (dwt_getrangebiastable(selected.chan, selected.prf, bias_cm) != 0)
+    {
+        LOG_ERR("Failed to build range bias table for channel %u", selected.chan);
+        memset(bias_cm, 0, sizeof(bias_cm));
+    }
+}
+
+int32_t uwb_range_bias_mm(int32_t range_mm)
+{
+    if (selected.stale)
+    {
+        build_table();
+    }
+
+    // truncate toward zero like the driver, ranges below one step share the first entry
+    int32_t step = range_mm / UWB_RANGE_BIAS_STEP_MM;
+    if (step < 0)
+    {
+        step = 0;
+    }
+    else if (step >= DWT_RANGE_BIAS_STEPS)
+    {
+        step = DWT_RANGE_BIAS_STEPS - 1;
+    }
+
+    return bias_cm[step] * 10;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file uwb_rx_quality.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_rx_quality.h"
+
+// Receiver constant A in 0.01 dB
+#define RX_CONSTANT_PRF16_CDB 11377
+#define RX_CONSTANT_PRF64_CDB 12174
+
+// 10 * log10(2) in 0.0001 dB
+#define OCTAVE_DB_E4 30103
+
+#define MANTISSA_BITS 6
+
+// SFD symbols counted in RXPACC when it equals RXPACC_NOSAT (user manual table 18)
+#define RXPACC_SFD_STD_8 5
+#define RXPACC_SFD_STD_64 64
+#define RXPACC_SFD_NSTD_8 10
+#define RXPACC_SFD_NSTD_16 18
+#define RXPACC_SFD_NSTD_64 82
+
+// 10 * log10(1 + i / 64) in 0.01 dB, the last entry catches mantissas rounded up
+static const uint16_t log_mantissa_cdb[(1 << MANTISSA_BITS) + 1] = {
+    0, 7, 13, 20, 26, 33, 39, 45, 51, 57, 63, 69, 75, 80, 86, 91,
+    97, 102, 108, 113, 118, 123, 128, 133, 138, 143, 148, 153, 158, 162, 167, 172,
+    176, 181, 185, 189, 194, 198, 202, 207, 211, 215, 219, 223, 227, 231, 235, 239,
+    243, 247, 251, 255, 258, 262, 266, 269, 273, 277, 280, 284, 287, 291, 294, 298,
+    301,
+};
+
+/**
+ * @brief 10 * log10(value) in 0.01 dB, accurate to 0.05 dB
+ * @param value: must not be 0
+ */
+static int32_t log10_cdb(uint64_t value)
+{
+    const int exponent = 63 - __builtin_clzll(value);
+    // keep one bit more than the table index to round to the nearest entry
+    uint32_t mantissa;
+    if (exponent > MANTISSA_BITS)
+    {
+        mantissa = value >> (exponent - MANTISSA_BITS - 1);
+    }
+    else
+    {
+        mantissa = value << (MANTISSA_BITS + 1 - exponent);
+    }
+    mantissa = ((mantissa & ((2 << MANTISSA_BITS) - 1)) + 1) >> 1;
+
+    return (exponent * OCTAVE_DB_E4 + 50) / 100 + log_mantissa_cdb[mantissa];
+}
+
+uint16_t uwb_rx_quality_preamble_count(uint16_t rxpacc, uint16_t rxpacc_nosat, const dwt_config_t *config)
+{
+    if (rxpacc != rxpacc_nosat)
+    {
+        return rxpacc;
+    }
+
+    // the SFD is 64 symbols at 110 kbps, the non-standard one 16 symbols at 850 kbps and 8 otherwise
+    uint16_t sfd;
+    if (config->dataRate == DWT_BR_110K)
+    {
+        sfd = config->nsSFD ? RXPACC_SFD_NSTD_64 : RXPACC_SFD_STD_64;
+    }
+    else if (config->nsSFD)
+    {
+        sfd = config->dataRate == DWT_BR_850K ? RXPACC_SFD_NSTD_16 : RXPACC_SFD_NSTD_8;
+    }
+    else
+    {
+        sfd = RXPACC_SFD_STD_8;
+    }
+
+    return rxpacc > sfd ? rxpacc - sfd : 0;
+}
+
+void uwb_rx_quality_compute(const dwt_rxdiag_t *diag, uint8_t prf, uwb_rx_quality_t *quality)
+{
+    quality->valid = false;
+    if (diag->rxPreamCount == 0 || diag->maxGrowthCIR == 0)
+    {
+        return;
+    }
+
+    const int32_t a = prf == DWT_PRF_16M ? RX_CONSTANT_PRF16_CDB : RX_CONSTANT_PRF64_CDB;
+    const int32_t n2 = 2 * log10_cdb(diag->rxPreamCount);
+
+    // first path power: 10 * log10((F1^2 + F2^2 + F3^2) / N^2) - A
+    const uint64_t f = (uint64_t)diag->firstPathAmp1 * diag->firstPathAmp1 +
+                       (uint64_t)diag->firstPathAmp2 * diag->firstPathAmp2 +
+                       (uint64_t)diag->firstPathAmp3 * diag->firstPathAmp3;
+    if (f == 0)
+    {
+        return;
+    }
+    const int32_t first_path_power = log10_cdb(f) - n2 - a;
+
+    // receive power: 10 * log10(C * 2^17 / N^2) - A
+    const int32_t rx_power = log10_cdb((uint64_t)diag->maxGrowthCIR << 17) - n2 - a;
+
+    // the first path carries most of the energy in line of sight
+    int32_t score = (rx_power - first_path_power - UWB_RX_QUALITY_LOS_CDB) * 100 /
+                    (UWB_RX_QUALITY_NLOS_CDB - UWB_RX_QUALITY_LOS_CDB);
+    if (score < 0)
+    {
+        score = 0;
+    }
+    else if (score > 100)
+    {
+        score = 100;
+    }
+
+    quality->first_path_index = diag->firstPath;
+    quality->first_path_power = first_path_power;
+    quality->rx_power = rx_power;
+    quality->nlos_score = score;
+    quality->valid = true;
+}
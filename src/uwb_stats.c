@@ -0,0 +1,163 @@
+/**
+ * @file uwb_stats.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_stats.h"
+
+#include "uwb_time.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+// DW1000 timestamps wrap every ~17.2 s, older intervals cannot be measured
+#define TIMESTAMP_WRAP_MS 17000
+// gain of the running mean interval and jitter estimates (1/16, as in RFC 3550)
+#define FILTER_SHIFT 4
+
+static uwb_stats_source_t sources[UWB_STATS_MAX_SOURCES];
+static struct k_spinlock lock;
+
+static uwb_stats_source_t *find_source(uint16_t address);
+
+static uwb_stats_source_t *find_source(uint16_t address)
+{
+    uwb_stats_source_t *oldest = &sources[0];
+    for (int i = 0; i < UWB_STATS_MAX_SOURCES; ++i)
+    {
+        if (sources[i].received != 0 && sources[i].address == address)
+        {
+            return &sources[i];
+        }
+        if (sources[i].last_rx_ms < oldest->last_rx_ms)
+        {
+            oldest = &sources[i];
+        }
+    }
+
+    memset(oldest, 0, sizeof(uwb_stats_source_t));
+    oldest->address = address;
+
+    return oldest;
+}
+
+void uwb_stats_record(uint16_t address, uint8_t sequence_number, uint64_t rx_timestamp)
+{
+    int64_t now_ms = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    uwb_stats_source_t *source = find_source(address);
+    if (source->received == 0)
+    {
+        source->received = 1;
+        source->last_sequence_number = sequence_number;
+        source->last_rx_timestamp = rx_timestamp;
+        source->last_rx_ms = now_ms;
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    const int64_t elapsed_ms = now_ms - source->last_rx_ms;
+    const int8_t sequence_delta = (int8_t)(sequence_number - source->last_sequence_number);
+    bool in_order = true;
+
+    ++source->received;
+    if (sequence_delta == 0)
+    {
+        ++source->duplicates;
+        in_order = false;
+    }
+    else if (sequence_delta < 0)
+    {
+        // a late frame was already counted as missed
+        ++source->out_of_order;
+        if (source->missed > 0)
+        {
+            --source->missed;
+        }
+        in_order = false;
+    }
+    else if (source->interval_us == 0 ||
+             elapsed_ms * 1000 < (int64_t)source->interval_us * INT8_MAX)
+    {
+        source->missed += sequence_delta - 1;
+    }
+    // else: silent for more than a sequence number period, the gap is unknown
+
+    if (in_order)
+    {
+        if (elapsed_ms < TIMESTAMP_WRAP_MS)
+        {
+            // only adjacent frames give a meaningful inter-arrival time
+            const uint64_t interval_ticks = uwb_time_elapsed(rx_timestamp, source->last_rx_timestamp);
+            const uint32_t interval_us = uwb_time_ticks_to_us(interval_ticks) / sequence_delta;
+            if (source->interval_us == 0)
+            {
+                source->interval_us = interval_us;
+            }
+            const int32_t deviation = abs((int32_t)interval_us - (int32_t)source->interval_us);
+            source->jitter_us += (deviation - (int32_t)source->jitter_us) >> FILTER_SHIFT;
+            source->interval_us += ((int32_t)interval_us - (int32_t)source->interval_us) >> FILTER_SHIFT;
+        }
+
+        source->last_sequence_number = sequence_number;
+        source->last_rx_timestamp = rx_timestamp;
+    }
+    source->last_rx_ms = now_ms;
+
+    k_spin_unlock(&lock, key);
+}
+
+int uwb_stats_read(int index, uwb_stats_source_t *source)
+{
+    if (index < 0 || index >= UWB_STATS_MAX_SOURCES)
+    {
+        return -1;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memcpy(source, &sources[index], sizeof(uwb_stats_source_t));
+    k_spin_unlock(&lock, key);
+
+    if (source->received == 0)
+    {
+        return -2;
+    }
+
+    return 0;
+}
+
+void uwb_stats_reset()
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memset(sources, 0, sizeof(sources));
+    k_spin_unlock(&lock, key);
+}
@@ -36,60 +36,203 @@
 #include "deca_spi.h"
 #include "mac.h"
 #include "port.h"
+#include "ramfunc.h"
+#include "uwb_protocol.h"
+#include "uwb_provision.h"
+#include "uwb_time.h"
 
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
-LOG_MODULE_REGISTER(tag, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(tag, CONFIG_TDOA_TAG_LOG_LEVEL);
+
+#define ANCHOR_CACHE_SIZE 16
+#define INFO_REQUEST_INTERVAL_MS 1000
+
+typedef struct
+{
+    uint16_t address;
+    bool has_info;
+    uint32_t x_pos_mm;
+    uint32_t y_pos_mm;
+    uint8_t phy_profile;
+    uint8_t clock_quality;
+    int64_t last_seen_ms;
+} anchor_entry_t;
 
 static uwb_config_t *uwb_config;
 
-static mac_packet_t rx_packet;
+static uwb_rx_frame_t rx_frame;
 
-typedef struct __packed
+static struct
 {
-    uint32_t anchor_x_pos_mm;
-    uint32_t anchor_y_pos_mm;
-} anchor_payload_t;
+    anchor_entry_t anchors[ANCHOR_CACHE_SIZE];
+    bool info_request_pending;
+    int64_t last_info_request_ms;
+} ctx;
 
 static void tag_init(uwb_config_t *config);
 static uint32_t tag_on_event(uwb_event_t event);
+static anchor_entry_t *find_anchor(uint16_t address);
+static int send_blink(uint8_t flags);
+static void handle_sync(const uwb_rx_frame_t *rx, const void *message);
+static void handle_sync_position(const uwb_rx_frame_t *rx, const void *message);
+static void handle_anchor_info(const uwb_rx_frame_t *rx, const void *message);
+
+static const uwb_protocol_handler_t handlers[UWB_PACKET_TYPE_MAX] = {
+    [UWB_PACKET_TYPE_SYNC] = handle_sync,
+    [UWB_PACKET_TYPE_SYNC_POSITION] = handle_sync_position,
+    [UWB_PACKET_TYPE_ANCHOR_INFO] = handle_anchor_info,
+    [UWB_PACKET_TYPE_CONFIG] = uwb_provision_handle,
+};
 
 static void tag_init(uwb_config_t *config)
 {
     uwb_config = config;
     LOG_DBG("Tag init");
-    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    memset(&ctx, 0, sizeof(ctx));
+    uwb_rx_enable();
+}
+
+/**
+ * @brief Find the cache entry of an anchor, evicting the least recently seen
+ * anchor if it is not cached yet
+ */
+static anchor_entry_t *find_anchor(uint16_t address)
+{
+    anchor_entry_t *oldest = &ctx.anchors[0];
+    for (int i = 0; i < ANCHOR_CACHE_SIZE; ++i)
+    {
+        anchor_entry_t *entry = &ctx.anchors[i];
+        if (entry->last_seen_ms != 0 && entry->address == address)
+        {
+            entry->last_seen_ms = k_uptime_get();
+            return entry;
+        }
+        if (entry->last_seen_ms < oldest->last_seen_ms)
+        {
+            oldest = entry;
+        }
+    }
+
+    memset(oldest, 0, sizeof(anchor_entry_t));
+    oldest->address = address;
+    oldest->last_seen_ms = k_uptime_get();
+
+    return oldest;
+}
+
+static int send_blink(uint8_t flags)
+{
+    union {
+        uwb_msg_blink_t blink;
+        uint8_t raw[sizeof(uwb_msg_blink_t) + sizeof(uwb_msg_config_ack_t)];
+    } tx_payload;
+    UWB_MESSAGE_INIT(&tx_payload.blink, UWB_PACKET_TYPE_BLINK);
+    tx_payload.blink.flags = flags;
+
+    mac_frame_t tx_frame;
+    MAC802154_FRAME_INIT(&tx_frame, UWB_PAN_ID, uwb_config->short_address);
+    tx_frame.payload = tx_payload.raw;
+    tx_frame.payload_length = sizeof(tx_payload.blink);
+    tx_frame.payload_length += uwb_provision_write_ack(&tx_payload.raw[tx_frame.payload_length],
+                                                       sizeof(tx_payload) - tx_frame.payload_length);
+
+    if (uwb_write_frame(&tx_frame) < 0)
+    {
+        return -1;
+    }
+
+    if (uwb_start_tx(DWT_START_TX_IMMEDIATE) != 0)
+    {
+        LOG_ERR("Failed to send blink");
+        return -2;
+    }
+
+    if (flags & UWB_BLINK_FLAG_INFO_REQUEST)
+    {
+        ctx.last_info_request_ms = k_uptime_get();
+    }
+
+    return 0;
+}
+
+static void handle_sync(const uwb_rx_frame_t *rx, const void *message)
+{
+    const uwb_msg_sync_t *sync = message;
+    anchor_entry_t *anchor = find_anchor(rx->mac.src.short_address);
+    if (!anchor->has_info)
+    {
+        ctx.info_request_pending = true;
+        LOG_DBG("Anchor '%04x' tx= %llu, rx= %llu (no info)",
+                rx->mac.src.short_address,
+                uwb_time_unpack(sync->tx_timestamp),
+                rx->rx_timestamp);
+        return;
+    }
+
+    LOG_DBG("Anchor '%04x' x= %u, y= %u, tx= %llu, rx= %llu",
+            rx->mac.src.short_address,
+            anchor->x_pos_mm,
+            anchor->y_pos_mm,
+            uwb_time_unpack(sync->tx_timestamp),
+            rx->rx_timestamp);
 }
 
-static uint32_t tag_on_event(uwb_event_t event)
+static void handle_sync_position(const uwb_rx_frame_t *rx, const void *message)
 {
-    if (event == UWB_EVENT_PACKET_RECEIVED)
+    const uwb_msg_sync_position_t *sync = message;
+    anchor_entry_t *anchor = find_anchor(rx->mac.src.short_address);
+    anchor->x_pos_mm = sync->x_pos_mm;
+    anchor->y_pos_mm = sync->y_pos_mm;
+    anchor->has_info = true;
+
+    handle_sync(rx, message);
+}
+
+static void handle_anchor_info(const uwb_rx_frame_t *rx, const void *message)
+{
+    const uwb_msg_anchor_info_t *info = message;
+    anchor_entry_t *anchor = find_anchor(rx->mac.src.short_address);
+    anchor->x_pos_mm = info->x_pos_mm;
+    anchor->y_pos_mm = info->y_pos_mm;
+    anchor->phy_profile = info->phy_profile;
+    anchor->clock_quality = info->clock_quality;
+    anchor->has_info = true;
+
+    handle_sync(rx, message);
+}
+
+static TDOA_RAMFUNC uint32_t tag_on_event(uwb_event_t event)
+{
+    if (event != UWB_EVENT_PACKET_RECEIVED)
     {
+        uwb_rx_enable();
+        return UWB_TIMEOUT_MAXIMUM;
+    }
 
-        uint32_t read_size = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFLEN_MASK;
-        if (read_size > MAC80215_PACKET_SIZE)
-            read_size = MAC80215_PACKET_SIZE;
-
-        dwt_readrxdata((uint8_t *)&rx_packet, read_size, 0);
-        dwt_rxenable(DWT_START_RX_IMMEDIATE);
-
-        anchor_payload_t *anchor_payload = (anchor_payload_t *)&rx_packet.payload;
-        uint8_t *src = rx_packet.src_address;
-        LOG_DBG("Anchor '%u:%u:%u:%u:%u:%u:%u:%u' x= %u, y= %u",
-                src[0],
-                src[1],
-                src[2],
-                src[3],
-                src[4],
-                src[5],
-                src[6],
-                src[7],
-                anchor_payload->anchor_x_pos_mm,
-                anchor_payload->anchor_y_pos_mm);
+    // the frame is read from RAM and handled from flash once the receiver listens again
+    const int ret = uwb_read_frame(&rx_frame);
+    uwb_rx_enable();
+    if (uwb_process_frame(&rx_frame, ret) == 0 && uwb_protocol_dispatch(handlers, &rx_frame) >= 0)
+    {
+        uwb_provision_receive_ack(&rx_frame);
     }
-    else
+
+    const bool request_info = ctx.info_request_pending &&
+                              k_uptime_get() - ctx.last_info_request_ms >= INFO_REQUEST_INTERVAL_MS;
+    if (request_info || uwb_provision_ack_pending())
     {
-        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        if (request_info)
+        {
+            ctx.info_request_pending = false;
+        }
+        // receiver is re-enabled once the blink has been sent
+        dwt_forcetrxoff();
+        if (send_blink(request_info ? UWB_BLINK_FLAG_INFO_REQUEST : 0) != 0)
+        {
+            uwb_rx_enable();
+        }
     }
 
     return UWB_TIMEOUT_MAXIMUM;
@@ -0,0 +1,298 @@
+/**
+ * @file uwb_xtal.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uwb_xtal.h"
+
+#include "config.h"
+#include "deca_regs.h"
+#include "uwb_phy.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(xtal, CONFIG_TDOA_XTAL_LOG_LEVEL);
+
+// Interval to check that the reference is still heard
+#define POLL_INTERVAL_MS 100
+
+static void xtal_init(uwb_config_t *config);
+static uint32_t xtal_on_event(uwb_event_t event);
+static void persist_trim(struct k_work *work);
+
+uwb_algorithm_t uwb_xtal_algorithm = {
+    .init = xtal_init,
+    .on_event = xtal_on_event,
+};
+
+static K_WORK_DEFINE(persist_work, persist_trim);
+
+// Guards the status shared with other threads
+static struct k_spinlock lock;
+static uwb_xtal_status_t status;
+
+// Only used by the uwb thread
+static struct
+{
+    int64_t offset_sum_ppb;
+    uint16_t count;
+    // the first frame after a trim change is received while the crystal settles
+    bool settling;
+    int64_t last_frame_ms;
+    uint8_t best_trim;
+    int32_t best_offset_ppb;
+} ctx;
+
+int uwb_xtal_prepare(uint16_t reference, uint16_t frames)
+{
+    if (frames == 0)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (status.state == UWB_XTAL_RUNNING)
+    {
+        ret = -2;
+    }
+    else
+    {
+        status = (uwb_xtal_status_t){
+            .state = UWB_XTAL_RUNNING,
+            .reference = reference,
+            .frames = frames,
+        };
+    }
+    k_spin_unlock(&lock, key);
+
+    return ret;
+}
+
+bool uwb_xtal_running()
+{
+    return status.state == UWB_XTAL_RUNNING;
+}
+
+void uwb_xtal_status(uwb_xtal_status_t *copy)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *copy = status;
+    k_spin_unlock(&lock, key);
+}
+
+int32_t uwb_xtal_offset_ppb(int32_t carrier_integrator, const dwt_config_t *config)
+{
+    float ppb_per_unit;
+    switch (config->chan)
+    {
+    case 1:
+        ppb_per_unit = (float)(FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_1 * 1000);
+        break;
+    case 2:
+    case 4:
+        ppb_per_unit = (float)(FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_2 * 1000);
+        break;
+    case 3:
+        ppb_per_unit = (float)(FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_3 * 1000);
+        break;
+    default:
+        ppb_per_unit = (float)(FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_5 * 1000);
+        break;
+    }
+    if (config->dataRate == DWT_BR_110K)
+    {
+        ppb_per_unit *= (float)(FREQ_OFFSET_MULTIPLIER_110KB / FREQ_OFFSET_MULTIPLIER);
+    }
+
+    return (int32_t)(carrier_integrator * ppb_per_unit);
+}
+
+static void xtal_init(uwb_config_t *config)
+{
+    const uint8_t trim = dwt_getxtaltrim();
+    LOG_INF("Calibrating crystal trim against '%04x', starting at %u", status.reference, trim);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.last_frame_ms = k_uptime_get();
+    ctx.best_trim = trim;
+    ctx.best_offset_ppb = INT32_MAX;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    status.initial_trim = trim;
+    status.trim = trim;
+    k_spin_unlock(&lock, key);
+
+    uwb_rx_enable();
+}
+
+static void finish(uwb_xtal_state_t state)
+{
+    // a failed calibration leaves the trim it started from
+    const uint8_t trim = state == UWB_XTAL_DONE ? ctx.best_trim : status.initial_trim;
+    dwt_setxtaltrim(trim);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    status.trim = trim;
+    status.state = state;
+    k_spin_unlock(&lock, key);
+
+    if (state == UWB_XTAL_DONE)
+    {
+        LOG_INF("Crystal trim calibrated to %u, residual offset %d ppb", trim, ctx.best_offset_ppb);
+        k_work_submit(&persist_work);
+    }
+    else
+    {
+        LOG_WRN("Crystal trim calibration failed, keeping %u", trim);
+    }
+}
+
+static void step(void)
+{
+    const int32_t offset_ppb = ctx.offset_sum_ppb / ctx.count;
+    ctx.offset_sum_ppb = 0;
+    ctx.count = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    const uint8_t trim = status.trim;
+    if (status.iteration == 0)
+    {
+        status.initial_offset_ppb = offset_ppb;
+    }
+    const uint8_t iteration = ++status.iteration;
+    status.offset_ppb = offset_ppb;
+    k_spin_unlock(&lock, key);
+
+    LOG_DBG("Trim %u: offset %d ppb", trim, offset_ppb);
+    if (abs(offset_ppb) < ctx.best_offset_ppb)
+    {
+        ctx.best_offset_ppb = abs(offset_ppb);
+        ctx.best_trim = trim;
+    }
+    if (abs(offset_ppb) <= UWB_XTAL_TOLERANCE_PPB || iteration >= UWB_XTAL_ITERATIONS_MAX)
+    {
+        finish(UWB_XTAL_DONE);
+        return;
+    }
+
+    // a higher trim slows this node down, which makes the reference appear faster
+    int next = trim - (offset_ppb + (offset_ppb < 0 ? -1 : 1) * UWB_XTAL_PPB_PER_STEP / 2) / UWB_XTAL_PPB_PER_STEP;
+    next = CLAMP(next, 0, FS_XTALT_MASK);
+    if (next == trim)
+    {
+        finish(UWB_XTAL_DONE);
+        return;
+    }
+
+    dwt_setxtaltrim(next);
+    ctx.settling = true;
+
+    key = k_spin_lock(&lock);
+    status.trim = next;
+    k_spin_unlock(&lock, key);
+}
+
+static void handle_rx_packet(void)
+{
+    uwb_rx_frame_t rx;
+    if (uwb_process_frame(&rx, uwb_read_frame(&rx)) != 0)
+    {
+        return;
+    }
+    if (rx.mac.src.mode != MAC802154_ADDR_MODE_SHORT || rx.mac.src.short_address != status.reference)
+    {
+        return;
+    }
+
+    // the carrier integrator belongs to the frame just received, read it before reception restarts
+    const int32_t carrier_integrator = dwt_readcarrierintegrator();
+    ctx.last_frame_ms = k_uptime_get();
+    if (ctx.settling)
+    {
+        ctx.settling = false;
+        return;
+    }
+
+    ctx.offset_sum_ppb += uwb_xtal_offset_ppb(carrier_integrator, &uwb_phy_profile(uwb_phy_current())->config);
+    if (++ctx.count >= status.frames)
+    {
+        step();
+    }
+}
+
+static uint32_t xtal_on_event(uwb_event_t event)
+{
+    if (!uwb_xtal_running())
+    {
+        return UWB_TIMEOUT_MAXIMUM;
+    }
+
+    bool restart_rx = false;
+    switch (event)
+    {
+    case UWB_EVENT_PACKET_RECEIVED:
+        handle_rx_packet();
+        restart_rx = true;
+        break;
+    case UWB_EVENT_RECEIVE_TIMEOUT:
+    case UWB_EVENT_RECEIVE_FAILED:
+        restart_rx = true;
+        break;
+    default:
+        break;
+    }
+
+    // other nodes keep the radio thread busy, so the reference is checked on every event
+    if (uwb_xtal_running() && k_uptime_get() - ctx.last_frame_ms > UWB_XTAL_REFERENCE_TIMEOUT_MS)
+    {
+        LOG_WRN("Reference '%04x' not heard", status.reference);
+        finish(UWB_XTAL_FAILED);
+    }
+    if (restart_rx && uwb_xtal_running())
+    {
+        uwb_rx_enable();
+    }
+
+    return POLL_INTERVAL_MS;
+}
+
+static void persist_trim(struct k_work *work)
+{
+    uwb_xtal_status_t result;
+    uwb_xtal_status(&result);
+
+    if (config_set(CONFIG_FIELD_XTAL_TRIM, &result.trim, sizeof(result.trim)) != 0)
+    {
+        LOG_ERR("Failed to store crystal trim %u", result.trim);
+    }
+}
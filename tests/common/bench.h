@@ -0,0 +1,76 @@
+/**
+ * @file bench.h
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+/**
+ * @brief Benchmarked operation
+ * @param i: iteration, to vary the input so calls are not folded away
+ * @return result, accumulated so calls are not dropped
+ */
+typedef uint64_t (*bench_fn_t)(uint32_t i);
+
+static volatile uint64_t bench_sink;
+
+/**
+ * @brief Run an operation a number of times and print the mean time per call,
+ * including the indirect call. Only meaningful on hardware, native_sim does
+ * not advance time while code runs
+ * @return mean time per call in ns
+ */
+static inline uint64_t bench_run(const char *name, bench_fn_t fn, uint32_t runs)
+{
+    timing_init();
+    timing_start();
+
+    uint64_t sink = 0;
+    timing_t start = timing_counter_get();
+    for (uint32_t i = 0; i < runs; ++i)
+    {
+        sink += fn(i);
+    }
+    timing_t end = timing_counter_get();
+    bench_sink = sink;
+
+    const uint64_t ns = timing_cycles_to_ns(timing_cycles_get(&start, &end)) / runs;
+    timing_stop();
+
+    TC_PRINT("%-40s %8llu ns\n", name, ns);
+
+    return ns;
+}
+
+#endif // __BENCH_H__
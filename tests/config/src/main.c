@@ -0,0 +1,264 @@
+/**
+ * @file main.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Built white-box so the TLV index and the lookup helpers can be reached
+#include "../../../src/config.c"
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <zephyr/ztest.h>
+
+#define BENCH_RUNS 10000
+
+static const int field_counts[] = {4, 32, 128};
+
+// The lookup used before the index was added, kept as the reference
+static int linear_find(config_field_t field)
+{
+    int pos = 0;
+    while (pos < header->tlv_length)
+    {
+        if (tlv.data[pos] == field)
+        {
+            return pos;
+        }
+
+        pos += tlv.data[pos + 1] + 2;
+    }
+
+    return -1;
+}
+
+// config_init is not run, so there is nothing to record
+void boot_mark(boot_phase_t phase)
+{
+}
+
+static void fill_image(int count)
+{
+    reset_image();
+    for (int field = 0; field < count; ++field)
+    {
+        const uint32_t value = field * 0x01010101U;
+        zassert_equal(append_value(field, sizeof(value), &value), sizeof(value));
+    }
+}
+
+static void check_index()
+{
+    for (int field = 0; field < CONFIG_FIELD_ID_MAX; ++field)
+    {
+        zassert_equal(find_field(field), linear_find(field), "field %d", field);
+    }
+}
+
+static void *config_setup(void)
+{
+    tlv.data = &_buffer[SIZE_HEADER];
+    return NULL;
+}
+
+ZTEST(config, test_index_matches_scan)
+{
+    for (int i = 0; i < ARRAY_SIZE(field_counts); ++i)
+    {
+        fill_image(field_counts[i]);
+        check_index();
+
+        uint32_t value;
+        const int last = field_counts[i] - 1;
+        zassert_ok(read_value(last, sizeof(value), &value));
+        zassert_equal(value, last * 0x01010101U);
+    }
+}
+
+ZTEST(config, test_index_follows_resize)
+{
+    fill_image(32);
+
+    // grow, then shrink a field in the middle so every later entry moves
+    const uint8_t grown[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    zassert_equal(insert_value(find_field(10), 10, sizeof(grown), grown), sizeof(grown));
+    check_index();
+
+    const uint8_t shrunk = 0x5A;
+    zassert_equal(insert_value(find_field(10), 10, sizeof(shrunk), &shrunk), sizeof(shrunk));
+    check_index();
+
+    uint32_t value;
+    zassert_ok(read_value(31, sizeof(value), &value));
+    zassert_equal(value, 31 * 0x01010101U);
+}
+
+ZTEST(config, test_index_reset)
+{
+    fill_image(32);
+    reset_image();
+    check_index();
+    zassert_equal(find_field(0), -1);
+
+    fill_image(32);
+    zassert_ok(build_index());
+    check_index();
+}
+
+ZTEST_SUITE(config, NULL, config_setup, NULL, NULL, NULL);
+
+// One NVS allocation table entry and a value of up to 8 bytes
+#define SINGLE_WRITE_MAX 16
+
+static void *commit_setup(void)
+{
+    zassert_ok(config_init());
+    return NULL;
+}
+
+static void check_stored(config_field_t field, uint16_t expected)
+{
+    uint16_t stored = 0;
+    zassert_equal(nvs_read(&fs, FIELD_NVS_ID(field), &stored, sizeof(stored)), sizeof(stored));
+    zassert_equal(stored, expected, "field %d", field);
+}
+
+static void check_no_record()
+{
+    uint8_t record[SIZE_HEADER];
+    zassert_equal(nvs_read(&fs, CONFIG_NVS_ID, record, sizeof(record)), -ENOENT);
+    zassert_equal(config_fields_count(&pending_fields), 0);
+}
+
+ZTEST(config_commit, test_single_field_writes_entry_only)
+{
+    uint16_t delay;
+    zassert_ok(config_get(CONFIG_FIELD_TX_ANTENNA_DELAY, &delay, sizeof(delay)));
+    ++delay;
+
+    const ssize_t before = nvs_calc_free_space(&fs);
+    zassert_ok(config_set(CONFIG_FIELD_TX_ANTENNA_DELAY, &delay, sizeof(delay)));
+    const ssize_t used = before - nvs_calc_free_space(&fs);
+
+    zassert_true(used <= SINGLE_WRITE_MAX, "single field commit used %d bytes", (int)used);
+    check_stored(CONFIG_FIELD_TX_ANTENNA_DELAY, delay);
+    check_no_record();
+}
+
+ZTEST(config_commit, test_multi_field_uses_record)
+{
+    uint16_t tx_delay;
+    uint16_t rx_delay;
+    zassert_ok(config_get(CONFIG_FIELD_TX_ANTENNA_DELAY, &tx_delay, sizeof(tx_delay)));
+    zassert_ok(config_get(CONFIG_FIELD_RX_ANTENNA_DELAY, &rx_delay, sizeof(rx_delay)));
+    tx_delay += 2;
+    rx_delay += 3;
+
+    const ssize_t before = nvs_calc_free_space(&fs);
+    config_begin();
+    zassert_ok(config_set(CONFIG_FIELD_TX_ANTENNA_DELAY, &tx_delay, sizeof(tx_delay)));
+    zassert_ok(config_set(CONFIG_FIELD_RX_ANTENNA_DELAY, &rx_delay, sizeof(rx_delay)));
+    zassert_ok(config_commit());
+    const ssize_t used = before - nvs_calc_free_space(&fs);
+
+    // the record holds the whole image
+    zassert_true(used > 2 * SINGLE_WRITE_MAX, "multi field commit used %d bytes", (int)used);
+    check_stored(CONFIG_FIELD_TX_ANTENNA_DELAY, tx_delay);
+    check_stored(CONFIG_FIELD_RX_ANTENNA_DELAY, rx_delay);
+    check_no_record();
+}
+
+ZTEST_SUITE(config_commit, NULL, commit_setup, NULL, NULL, NULL);
+
+static int bench_count;
+
+static uint64_t bench_indexed(uint32_t i)
+{
+    return find_field(i % bench_count);
+}
+
+static uint64_t bench_linear(uint32_t i)
+{
+    return linear_find(i % bench_count);
+}
+
+static uint64_t bench_read(uint32_t i)
+{
+    uint32_t value = 0;
+    read_value(i % bench_count, sizeof(value), &value);
+    return value;
+}
+
+static uint64_t bench_build_index(uint32_t i)
+{
+    return build_index();
+}
+
+// Alternately grow and shrink the middle field, so every later entry moves
+static uint64_t bench_resize(uint32_t i)
+{
+    static const uint8_t value[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    const config_field_t field = bench_count / 2;
+    return insert_value(find_field(field), field, (i & 1) ? 4 : 8, value);
+}
+
+ZTEST(config_bench, test_lookup)
+{
+    for (int i = 0; i < ARRAY_SIZE(field_counts); ++i)
+    {
+        bench_count = field_counts[i];
+        fill_image(bench_count);
+
+        char name[48];
+        snprintf(name, sizeof(name), "linear scan, %d fields", bench_count);
+        bench_run(name, bench_linear, BENCH_RUNS);
+        snprintf(name, sizeof(name), "find_field, %d fields", bench_count);
+        bench_run(name, bench_indexed, BENCH_RUNS);
+        snprintf(name, sizeof(name), "read_value, %d fields", bench_count);
+        bench_run(name, bench_read, BENCH_RUNS);
+        snprintf(name, sizeof(name), "build_index, %d fields", bench_count);
+        bench_run(name, bench_build_index, BENCH_RUNS / 10);
+    }
+}
+
+ZTEST(config_bench, test_update)
+{
+    for (int i = 0; i < ARRAY_SIZE(field_counts); ++i)
+    {
+        bench_count = field_counts[i];
+        fill_image(bench_count);
+
+        char name[48];
+        snprintf(name, sizeof(name), "resizing insert_value, %d fields", bench_count);
+        bench_run(name, bench_resize, BENCH_RUNS);
+        check_index();
+    }
+}
+
+ZTEST_SUITE(config_bench, NULL, config_setup, NULL, NULL, NULL);
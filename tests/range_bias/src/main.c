@@ -0,0 +1,120 @@
+/**
+ * @file main.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+#include "deca_range_tables.h"
+#include "uwb_range_bias.h"
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+#define BENCH_RUNS 10000
+
+// Past the end of every driver table, so the clamped last entry is covered
+#define RANGE_MIN_MM -1000
+#define RANGE_MAX_MM 70000
+
+static const uint8_t channels[] = {1, 2, 3, 4, 5, 7};
+static const uint8_t prfs[] = {DWT_PRF_16M, DWT_PRF_64M};
+
+static int init_table(uint8_t chan, uint8_t prf)
+{
+    const dwt_config_t config = {.chan = chan, .prf = prf};
+    return uwb_range_bias_init(&config);
+}
+
+static int32_t driver_bias_mm(uint8_t chan, uint8_t prf, int32_t range_mm)
+{
+    return lround(dwt_getrangebias(chan, range_mm / 1000.0f, prf) * 1000);
+}
+
+ZTEST(range_bias, test_matches_driver)
+{
+    for (int c = 0; c < ARRAY_SIZE(channels); ++c)
+    {
+        for (int p = 0; p < ARRAY_SIZE(prfs); ++p)
+        {
+            zassert_ok(init_table(channels[c], prfs[p]));
+            for (int32_t mm = RANGE_MIN_MM; mm <= RANGE_MAX_MM; ++mm)
+            {
+                zassert_equal(uwb_range_bias_mm(mm), driver_bias_mm(channels[c], prfs[p], mm),
+                              "channel %u, prf %u, range %d mm", channels[c], prfs[p], mm);
+            }
+        }
+    }
+}
+
+ZTEST(range_bias, test_unsupported_channel)
+{
+    zassert_true(init_table(0, DWT_PRF_16M) < 0);
+    zassert_true(init_table(6, DWT_PRF_64M) < 0);
+    zassert_true(init_table(8, DWT_PRF_16M) < 0);
+}
+
+ZTEST(range_bias, test_correct)
+{
+    zassert_ok(init_table(5, DWT_PRF_64M));
+    zassert_equal(uwb_range_bias_correct_mm(10000), 10000 - uwb_range_bias_mm(10000));
+}
+
+ZTEST_SUITE(range_bias, NULL, NULL, NULL, NULL, NULL);
+
+// Ranges spread over the whole table
+static int32_t bench_range(uint32_t i)
+{
+    return (i * 997) % RANGE_MAX_MM;
+}
+
+static uint64_t bench_driver(uint32_t i)
+{
+    return dwt_getrangebias(5, bench_range(i) / 1000.0f, DWT_PRF_64M) * 1000;
+}
+
+static uint64_t bench_table(uint32_t i)
+{
+    return uwb_range_bias_mm(bench_range(i));
+}
+
+static uint64_t bench_baseline(uint32_t i)
+{
+    return bench_range(i);
+}
+
+ZTEST(range_bias_bench, test_lookup)
+{
+    zassert_ok(init_table(5, DWT_PRF_64M));
+
+    bench_run("baseline (call and input)", bench_baseline, BENCH_RUNS);
+    bench_run("dwt_getrangebias", bench_driver, BENCH_RUNS);
+    bench_run("uwb_range_bias_mm", bench_table, BENCH_RUNS);
+}
+
+ZTEST_SUITE(range_bias_bench, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,94 @@
+/**
+ * @file main.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Built white-box so the fixed-point log can be checked directly
+#include "../../../src/uwb_rx_quality.c"
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+// Worst case error of log10_cdb in 0.01 dB
+#define LOG_ERROR_MAX_CDB 5
+
+static void check_log(uint64_t value)
+{
+    const double expected = 1000 * log10((double)value);
+    zassert_within(log10_cdb(value), lround(expected), LOG_ERROR_MAX_CDB, "value %llu", value);
+}
+
+ZTEST(rx_quality, test_log_small)
+{
+    for (uint64_t value = 1; value < (1 << 20); ++value)
+    {
+        check_log(value);
+    }
+}
+
+ZTEST(rx_quality, test_log_large)
+{
+    // every octave up to the largest CIR power, with a few mantissas each
+    for (int exponent = 20; exponent < 58; ++exponent)
+    {
+        for (uint64_t step = 0; step < 4096; ++step)
+        {
+            check_log((1ULL << exponent) + (step << (exponent - 12)));
+        }
+    }
+}
+
+ZTEST(rx_quality, test_log_exact)
+{
+    zassert_equal(log10_cdb(1), 0);
+    zassert_equal(log10_cdb(10), 1000);
+    zassert_equal(log10_cdb(1000000), 6000);
+    zassert_equal(log10_cdb(2), 301);
+}
+
+ZTEST(rx_quality, test_preamble_count)
+{
+    const dwt_config_t std_6m8 = {.dataRate = DWT_BR_6M8, .nsSFD = 0};
+    const dwt_config_t nstd_6m8 = {.dataRate = DWT_BR_6M8, .nsSFD = 1};
+    const dwt_config_t nstd_850k = {.dataRate = DWT_BR_850K, .nsSFD = 1};
+    const dwt_config_t std_110k = {.dataRate = DWT_BR_110K, .nsSFD = 0};
+    const dwt_config_t nstd_110k = {.dataRate = DWT_BR_110K, .nsSFD = 1};
+
+    // a saturated count is reported as is
+    zassert_equal(uwb_rx_quality_preamble_count(120, 135, &nstd_6m8), 120);
+
+    zassert_equal(uwb_rx_quality_preamble_count(120, 120, &std_6m8), 115);
+    zassert_equal(uwb_rx_quality_preamble_count(120, 120, &nstd_6m8), 110);
+    zassert_equal(uwb_rx_quality_preamble_count(120, 120, &nstd_850k), 102);
+    zassert_equal(uwb_rx_quality_preamble_count(1000, 1000, &std_110k), 936);
+    zassert_equal(uwb_rx_quality_preamble_count(1000, 1000, &nstd_110k), 918);
+    zassert_equal(uwb_rx_quality_preamble_count(3, 3, &std_6m8), 0);
+}
+
+ZTEST_SUITE(rx_quality, NULL, NULL, NULL, NULL, NULL);
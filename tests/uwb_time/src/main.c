@@ -0,0 +1,181 @@
+/**
+ * @file main.c
+ * @author Nicholas Loehrke (nicholasnloehrke@gmail.com)
+ * @brief
+ * @version 1.0.0
+ * @date 2024-03-19
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Nicholas Loehrke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+#include "uwb_time.h"
+
+#include <zephyr/ztest.h>
+
+#define WRAP (1ULL << UWB_TIME_BITS)
+#define HALF_WRAP (1ULL << (UWB_TIME_BITS - 1))
+
+#define BENCH_RUNS 10000
+
+ZTEST(uwb_time, test_pack_unpack)
+{
+    static const uint64_t times[] = {0, 1, 0xFFFFFFFFULL, 0x100000000ULL, HALF_WRAP, UWB_TIME_MASK};
+    for (int i = 0; i < ARRAY_SIZE(times); ++i)
+    {
+        uint8_t buffer[UWB_TIME_SIZE + 1] = {[UWB_TIME_SIZE] = 0xA5};
+        uwb_time_pack(times[i], buffer);
+        zassert_equal(uwb_time_unpack(buffer), times[i], "round trip of %llx", times[i]);
+        zassert_equal(buffer[UWB_TIME_SIZE], 0xA5, "pack wrote past 5 bytes");
+    }
+
+    const uint8_t buffer[UWB_TIME_SIZE] = {0x01, 0x02, 0x03, 0x04, 0x05};
+    zassert_equal(uwb_time_unpack(buffer), 0x0504030201ULL);
+}
+
+ZTEST(uwb_time, test_add_wraps)
+{
+    zassert_equal(uwb_time_add(UWB_TIME_MASK, 1), 0);
+    zassert_equal(uwb_time_add(UWB_TIME_MASK - 10, 20), 9);
+    zassert_equal(uwb_time_add(0, -1), UWB_TIME_MASK);
+    zassert_equal(uwb_time_add(5, -10), UWB_TIME_MASK - 4);
+    zassert_equal(uwb_time_add(123, WRAP), 123, "a full period is a no-op");
+    zassert_equal(uwb_time_add(123, -(int64_t)WRAP), 123);
+}
+
+ZTEST(uwb_time, test_elapsed_across_wrap)
+{
+    zassert_equal(uwb_time_elapsed(5, UWB_TIME_MASK - 4), 10);
+    zassert_equal(uwb_time_elapsed(0, UWB_TIME_MASK), 1);
+    zassert_equal(uwb_time_elapsed(42, 42), 0);
+    zassert_equal(uwb_time_elapsed(UWB_TIME_MASK, 0), UWB_TIME_MASK);
+    zassert_equal(uwb_time_elapsed(uwb_time_add(HALF_WRAP + 7, HALF_WRAP), HALF_WRAP + 7), HALF_WRAP);
+}
+
+ZTEST(uwb_time, test_diff_across_wrap)
+{
+    zassert_equal(uwb_time_diff(5, UWB_TIME_MASK - 4), 10);
+    zassert_equal(uwb_time_diff(UWB_TIME_MASK - 4, 5), -10);
+    zassert_equal(uwb_time_diff(0, UWB_TIME_MASK), 1);
+    zassert_equal(uwb_time_diff(UWB_TIME_MASK, 0), -1);
+    zassert_equal(uwb_time_diff(7, 7), 0);
+
+    // the sign flips at half a period
+    zassert_equal(uwb_time_diff(HALF_WRAP - 1, 0), (int64_t)HALF_WRAP - 1);
+    zassert_equal(uwb_time_diff(HALF_WRAP, 0), -(int64_t)HALF_WRAP);
+    zassert_equal(uwb_time_diff(uwb_time_add(UWB_TIME_MASK, HALF_WRAP - 1), UWB_TIME_MASK), (int64_t)HALF_WRAP - 1);
+
+    // inputs are only ever 40 bits, bits above are ignored
+    zassert_equal(uwb_time_diff(WRAP + 5, 3), 2);
+}
+
+ZTEST(uwb_time, test_after_across_wrap)
+{
+    zassert_true(uwb_time_after(5, UWB_TIME_MASK - 4));
+    zassert_false(uwb_time_after(UWB_TIME_MASK - 4, 5));
+    zassert_false(uwb_time_after(9, 9));
+    zassert_true(uwb_time_after(HALF_WRAP - 1, 0));
+    zassert_false(uwb_time_after(HALF_WRAP, 0));
+}
+
+ZTEST(uwb_time, test_unit_conversions)
+{
+    zassert_equal(uwb_time_ticks_to_ps(UWB_TIME_PS_DEN), UWB_TIME_PS_NUM);
+    zassert_equal(uwb_time_ps_to_ticks(UWB_TIME_PS_NUM), UWB_TIME_PS_DEN);
+    zassert_equal(uwb_time_ticks_to_us(UWB_TIME_TICKS_PER_S), 1000000);
+    zassert_equal(uwb_time_us_to_ticks(1000000), UWB_TIME_TICKS_PER_S);
+    // a full wrap period is ~17.2 s
+    zassert_equal(uwb_time_ticks_to_us(UWB_TIME_MASK), 17207401);
+
+    // light travels 299792458 mm in 1 ms
+    zassert_equal(uwb_time_ticks_to_mm(UWB_TIME_TICKS_PER_S / 1000), 299792458);
+    zassert_equal(uwb_time_ticks_to_mm(-(int64_t)(UWB_TIME_TICKS_PER_S / 1000)), -299792458);
+    zassert_equal(uwb_time_mm_to_ticks(299792458), UWB_TIME_TICKS_PER_S / 1000);
+    // one tick is ~4.7 mm
+    zassert_equal(uwb_time_ticks_to_mm(213), 999);
+}
+
+ZTEST(uwb_time, test_cycle_conversions)
+{
+    const uint64_t hz = sys_clock_hw_cycles_per_sec();
+    zassert_equal(uwb_time_ticks_to_cycles(UWB_TIME_TICKS_PER_S), hz);
+    zassert_equal(uwb_time_cycles_to_ticks(hz), UWB_TIME_TICKS_PER_S);
+
+    // the largest device duration must not overflow the product
+    const uint64_t cycles = uwb_time_ticks_to_cycles(UWB_TIME_MASK);
+    zassert_within(cycles, UWB_TIME_MASK / UWB_TIME_TICKS_PER_S * hz + (UWB_TIME_MASK % UWB_TIME_TICKS_PER_S) * hz / UWB_TIME_TICKS_PER_S, 1);
+    zassert_within(uwb_time_cycles_to_ticks(cycles), UWB_TIME_MASK, UWB_TIME_TICKS_PER_S / hz + 1);
+}
+
+ZTEST_SUITE(uwb_time, NULL, NULL, NULL, NULL, NULL);
+
+// Timestamps straddling the wrap so every call crosses it
+static uint64_t wrap_time(uint32_t i)
+{
+    return uwb_time_add(UWB_TIME_MASK - 512, i & 1023);
+}
+
+static uint64_t bench_unpack(uint32_t i)
+{
+    uint8_t buffer[UWB_TIME_SIZE];
+    uwb_time_pack(wrap_time(i), buffer);
+    return uwb_time_unpack(buffer);
+}
+
+static uint64_t bench_add(uint32_t i)
+{
+    return uwb_time_add(wrap_time(i), 1000);
+}
+
+static uint64_t bench_elapsed(uint32_t i)
+{
+    return uwb_time_elapsed(wrap_time(i), wrap_time(i + 600));
+}
+
+static uint64_t bench_diff(uint32_t i)
+{
+    return uwb_time_diff(wrap_time(i), wrap_time(i + 600));
+}
+
+static uint64_t bench_ticks_to_mm(uint32_t i)
+{
+    return uwb_time_ticks_to_mm(wrap_time(i) & 0xFFFFFF);
+}
+
+static uint64_t bench_baseline(uint32_t i)
+{
+    return wrap_time(i);
+}
+
+ZTEST(uwb_time_bench, test_wrap_boundary)
+{
+    bench_run("baseline (call and input)", bench_baseline, BENCH_RUNS);
+    bench_run("uwb_time_pack + uwb_time_unpack", bench_unpack, BENCH_RUNS);
+    bench_run("uwb_time_add", bench_add, BENCH_RUNS);
+    bench_run("uwb_time_elapsed", bench_elapsed, BENCH_RUNS);
+    bench_run("uwb_time_diff", bench_diff, BENCH_RUNS);
+    bench_run("uwb_time_ticks_to_mm", bench_ticks_to_mm, BENCH_RUNS);
+}
+
+ZTEST_SUITE(uwb_time_bench, NULL, NULL, NULL, NULL, NULL);